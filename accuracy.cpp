@@ -0,0 +1,118 @@
+#include "accuracy.h"
+
+#include <QStringList>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+	bool isCjk(uint c) {
+		return (c >= 0x3040 && c <= 0x30ff)     // Hiragana, Katakana
+			|| (c >= 0x3400 && c <= 0x4dbf)     // CJK Extension A
+			|| (c >= 0x4e00 && c <= 0x9fff)     // CJK Unified Ideographs
+			|| (c >= 0xf900 && c <= 0xfaff)     // CJK Compatibility Ideographs
+			|| (c >= 0x3000 && c <= 0x303f)     // CJK punctuation
+			|| (c >= 0xff00 && c <= 0xffef)     // Half- and full-width forms
+			|| (c >= 0xac00 && c <= 0xd7af)     // Hangul syllables
+			|| (c >= 0x20000 && c <= 0x2ffff);  // Supplementary ideographs
+	}
+
+	bool isSpace(uint c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == 0x3000 || c == 0xa0;
+	}
+
+	// Single-row Levenshtein distance
+	template <typename T>
+	int editDistance(const std::vector<T>& a, const std::vector<T>& b) {
+		std::vector<int> row(b.size() + 1);
+		for (size_t j = 0; j <= b.size(); ++j) {
+			row[j] = static_cast<int>(j);
+		}
+		for (size_t i = 1; i <= a.size(); ++i) {
+			int diagonal = row[0];
+			row[0] = static_cast<int>(i);
+			for (size_t j = 1; j <= b.size(); ++j) {
+				const int above = row[j];
+				row[j] = std::min({ row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1) });
+				diagonal = above;
+			}
+		}
+		return row[b.size()];
+	}
+
+	std::vector<uint> codePoints(const QString& text) {
+		const auto ucs4 = text.toUcs4();
+		return std::vector<uint>(ucs4.begin(), ucs4.end());
+	}
+
+	std::vector<QString> words(const QString& text) {
+		std::vector<QString> tokens;
+		std::vector<uint> current;
+		auto flush = [&]() {
+			if (!current.empty()) {
+				tokens.push_back(QString::fromUcs4(reinterpret_cast<const char32_t*>(current.data()),
+					static_cast<int>(current.size())));
+				current.clear();
+			}
+		};
+
+		for (uint c : codePoints(normalizeForScoring(text))) {
+			if (isSpace(c)) {
+				flush();
+			}
+			else if (isCjk(c)) {
+				flush();
+				current.push_back(c);
+				flush();
+			}
+			else {
+				current.push_back(c);
+			}
+		}
+		flush();
+		return tokens;
+	}
+
+}
+
+QString normalizeForScoring(const QString& text) {
+	const std::vector<uint> input = codePoints(text);
+	std::vector<uint> output;
+	output.reserve(input.size());
+
+	bool pendingSpace = false;
+	for (uint c : input) {
+		if (isSpace(c)) {
+			pendingSpace = !output.empty();
+			continue;
+		}
+		if (pendingSpace && !isCjk(c) && !isCjk(output.back())) {
+			output.push_back(' ');
+		}
+		pendingSpace = false;
+		output.push_back(c);
+	}
+
+	return QString::fromUcs4(reinterpret_cast<const char32_t*>(output.data()),
+		static_cast<int>(output.size()));
+}
+
+ErrorCount characterErrors(const QString& reference, const QString& hypothesis) {
+	const std::vector<uint> ref = codePoints(normalizeForScoring(reference));
+	const std::vector<uint> hyp = codePoints(normalizeForScoring(hypothesis));
+
+	ErrorCount count;
+	count.errors = editDistance(ref, hyp);
+	count.reference = static_cast<int>(ref.size());
+	return count;
+}
+
+ErrorCount wordErrors(const QString& reference, const QString& hypothesis) {
+	const std::vector<QString> ref = words(reference);
+	const std::vector<QString> hyp = words(hypothesis);
+
+	ErrorCount count;
+	count.errors = editDistance(ref, hyp);
+	count.reference = static_cast<int>(ref.size());
+	return count;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QString>
+
+struct ErrorCount {
+	int errors = 0;     // Levenshtein distance to the reference
+	int reference = 0;  // Length of the reference
+
+	double rate() const { return reference > 0 ? double(errors) / reference : (errors > 0 ? 1.0 : 0.0); }
+
+	ErrorCount& operator+=(const ErrorCount& other) {
+		errors += other.errors;
+		reference += other.reference;
+		return *this;
+	}
+};
+
+// Collapses whitespace and drops the spaces Tesseract tends to insert
+// between CJK characters, so layout differences are not scored as errors
+QString normalizeForScoring(const QString& text);
+
+// Character error counts over Unicode code points of the normalized text
+ErrorCount characterErrors(const QString& reference, const QString& hypothesis);
+
+// Word error counts; every CJK character counts as a word since those
+// scripts are written without spaces
+ErrorCount wordErrors(const QString& reference, const QString& hypothesis);
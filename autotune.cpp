@@ -0,0 +1,281 @@
+#include "autotune.h"
+
+#include <tesseract/baseapi.h>
+// qt imports
+#include <QElapsedTimer>
+#include <QStringList>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include "accuracy.h"
+
+namespace {
+
+	// A setting the search varies, with the values it tries. The first
+	// value is the default.
+	struct Dimension {
+		QStringList values;
+		std::function<void(OcrOptions&, const QString&)> apply;
+	};
+
+	void setParam(OcrOptions& options, const QString& name, const QString& value) {
+		if (value.isEmpty()) {
+			options.params.remove(name);
+		}
+		else {
+			options.params[name] = value;
+		}
+	}
+
+	std::vector<Dimension> searchSpace() {
+		return {
+			// Engine mode. Legacy and combined need traineddata with the legacy
+			// model; with tessdata_fast or tessdata_best they fail to init and
+			// are skipped
+			{ { "3", "1", "0", "2" },
+				[](OcrOptions& o, const QString& v) { o.oem = v.toInt(); } },
+			// Page segmentation: automatic, single column, single block, sparse text
+			{ { "3", "4", "6", "11" },
+				[](OcrOptions& o, const QString& v) { o.psm = v.toInt(); } },
+			// Scale factor
+			{ { "1", "1.5", "2", "0.75" },
+				[](OcrOptions& o, const QString& v) { o.scale = v.toDouble(); } },
+			// Preprocessing
+			{ { "0", "1" },
+				[](OcrOptions& o, const QString& v) { o.invertDark = v == "1"; } },
+			{ { "0", "1" },
+				[](OcrOptions& o, const QString& v) { o.grayscale = v == "1"; } },
+			{ { "0", "128" },
+				[](OcrOptions& o, const QString& v) { o.binarizeThreshold = v.toInt(); } },
+			// Skips the second recognition pass Tesseract runs on lines it
+			// suspects to be inverted
+			{ { "", "0" },
+				[](OcrOptions& o, const QString& v) { setParam(o, "tessedit_do_invert", v); } },
+			// Thresholding: Otsu, Leptonica Otsu, Sauvola; Tesseract 5.3 and later
+			{ { "", "1", "2" },
+				[](OcrOptions& o, const QString& v) { setParam(o, "thresholding_method", v); } },
+			// Word lists
+			{ { "", "0" },
+				[](OcrOptions& o, const QString& v) {
+					setParam(o, "load_system_dawg", v);
+					setParam(o, "load_freq_dawg", v);
+				} },
+		};
+	}
+
+	struct Evaluation {
+		bool valid = false;
+		double cer = 1.0;
+		double p50Ms = 0.0;
+		double p95Ms = 0.0;
+	};
+
+	double percentile(std::vector<double> values, double p) {
+		if (values.empty()) {
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		const double rank = p * (values.size() - 1);
+		const size_t lower = static_cast<size_t>(rank);
+		const size_t upper = std::min(lower + 1, values.size() - 1);
+		return values[lower] + (values[upper] - values[lower]) * (rank - lower);
+	}
+
+	Evaluation evaluate(const QVector<CorpusSample>& samples, const QString& corpusDir, const OcrOptions& options) {
+		Evaluation evaluation;
+
+		// One engine per language, its init time added to every sample
+		std::map<QString, std::unique_ptr<tesseract::TessBaseAPI>> engines;
+		std::map<QString, double> initMs;
+		for (const CorpusSample& sample : samples) {
+			if (engines.count(sample.language)) {
+				continue;
+			}
+			auto engine = std::make_unique<tesseract::TessBaseAPI>();
+			QElapsedTimer timer;
+			timer.start();
+			if (!initEngine(*engine, sample.language, options)) {
+				return evaluation;
+			}
+			initMs[sample.language] = timer.nsecsElapsed() / 1e6;
+			engines[sample.language] = std::move(engine);
+		}
+
+		ErrorCount characters;
+		std::vector<double> latencies;
+		for (const CorpusSample& sample : samples) {
+			QElapsedTimer timer;
+			timer.start();
+			const OcrResult result = extractText(*engines[sample.language], corpusImagePath(corpusDir, sample), options);
+			latencies.push_back(timer.nsecsElapsed() / 1e6 + initMs[sample.language]);
+			characters += characterErrors(sample.text, result.text);
+		}
+
+		for (auto& engine : engines) {
+			engine.second->End();
+		}
+
+		evaluation.valid = true;
+		evaluation.cer = characters.rate();
+		evaluation.p50Ms = percentile(latencies, 0.50);
+		evaluation.p95Ms = percentile(latencies, 0.95);
+		return evaluation;
+	}
+
+	bool isFeasible(const Evaluation& evaluation, const AutotuneObjective& objective) {
+		if (objective.metric == AutotuneObjective::CharacterErrorRate) {
+			return objective.maxLatencyMs <= 0.0 || evaluation.p95Ms <= objective.maxLatencyMs;
+		}
+		return evaluation.cer <= objective.maxCer;
+	}
+
+	double cost(const Evaluation& evaluation, const AutotuneObjective& objective) {
+		switch (objective.metric) {
+		case AutotuneObjective::LatencyP50:
+			return evaluation.p50Ms;
+		case AutotuneObjective::CharacterErrorRate:
+			return evaluation.cer;
+		case AutotuneObjective::LatencyP95:
+		default:
+			return evaluation.p95Ms;
+		}
+	}
+
+	// Latency has to improve by this much to count, so timing noise does
+	// not pull in settings that change nothing
+	constexpr double kMinLatencyGain = 0.03;
+
+	// Feasible beats infeasible; between two infeasible configurations the
+	// one closer to the constraint wins
+	bool isBetter(const Evaluation& candidate, const Evaluation& best, const AutotuneObjective& objective) {
+		const bool candidateFeasible = isFeasible(candidate, objective);
+		const bool bestFeasible = isFeasible(best, objective);
+		if (candidateFeasible != bestFeasible) {
+			return candidateFeasible;
+		}
+		if (!candidateFeasible) {
+			return objective.metric == AutotuneObjective::CharacterErrorRate
+				? candidate.p95Ms < best.p95Ms
+				: candidate.cer < best.cer;
+		}
+		if (objective.metric == AutotuneObjective::CharacterErrorRate) {
+			return candidate.cer < best.cer;
+		}
+		return cost(candidate, objective) < cost(best, objective) * (1.0 - kMinLatencyGain);
+	}
+
+}
+
+bool AutotuneObjective::parseMetric(const QString& name, Metric& metric) {
+	if (name == "p95") {
+		metric = LatencyP95;
+	}
+	else if (name == "p50") {
+		metric = LatencyP50;
+	}
+	else if (name == "cer") {
+		metric = CharacterErrorRate;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+QString describeOptions(const OcrOptions& options) {
+	const OcrOptions defaults;
+	QStringList parts;
+	if (options.oem != defaults.oem) {
+		parts << QString("oem=%1").arg(options.oem);
+	}
+	if (options.psm != defaults.psm) {
+		parts << QString("psm=%1").arg(options.psm);
+	}
+	if (options.scale != defaults.scale) {
+		parts << QString("scale=%1").arg(options.scale);
+	}
+	if (options.invertDark) {
+		parts << "invert_dark";
+	}
+	if (options.grayscale) {
+		parts << "grayscale";
+	}
+	if (options.binarizeThreshold > 0) {
+		parts << QString("binarize=%1").arg(options.binarizeThreshold);
+	}
+	if (options.cascadeConfidence > 0) {
+		parts << QString("cascade=%1").arg(options.cascadeConfidence);
+	}
+	for (auto it = options.params.constBegin(); it != options.params.constEnd(); ++it) {
+		parts << it.key() + "=" + it.value();
+	}
+	return parts.isEmpty() ? QString("defaults") : parts.join(' ');
+}
+
+AutotuneResult autotune(const QVector<CorpusSample>& samples, const QString& corpusDir,
+	const AutotuneObjective& objective, int maxEvaluations, QTextStream& log) {
+	const std::vector<Dimension> dimensions = searchSpace();
+
+	AutotuneResult result;
+	QStringList tried;
+
+	auto report = [&](const OcrOptions& options, const Evaluation& evaluation) {
+		log << QString("[%1] ").arg(result.evaluations, 3) << describeOptions(options) << ": ";
+		if (evaluation.valid) {
+			log << "CER " << QString::number(evaluation.cer * 100.0, 'f', 2) << "%, p50 "
+				<< QString::number(evaluation.p50Ms, 'f', 1) << " ms, p95 "
+				<< QString::number(evaluation.p95Ms, 'f', 1) << " ms"
+				<< (isFeasible(evaluation, objective) ? "" : " (violates constraint)") << "\n";
+		}
+		else {
+			log << "engine failed to initialize\n";
+		}
+		log.flush();
+	};
+
+	OcrOptions bestOptions;
+	Evaluation best = evaluate(samples, corpusDir, bestOptions);
+	++result.evaluations;
+	tried << describeOptions(bestOptions);
+	report(bestOptions, best);
+	if (!best.valid) {
+		return result;
+	}
+
+	bool improved = true;
+	while (improved && result.evaluations < maxEvaluations) {
+		improved = false;
+		for (const Dimension& dimension : dimensions) {
+			for (const QString& value : dimension.values) {
+				if (result.evaluations >= maxEvaluations) {
+					break;
+				}
+				OcrOptions candidate = bestOptions;
+				dimension.apply(candidate, value);
+				const QString key = describeOptions(candidate);
+				if (tried.contains(key)) {
+					continue;
+				}
+				tried << key;
+
+				const Evaluation evaluation = evaluate(samples, corpusDir, candidate);
+				++result.evaluations;
+				report(candidate, evaluation);
+				if (evaluation.valid && isBetter(evaluation, best, objective)) {
+					best = evaluation;
+					bestOptions = candidate;
+					improved = true;
+				}
+			}
+		}
+	}
+
+	result.options = bestOptions;
+	result.cer = best.cer;
+	result.p50Ms = best.p50Ms;
+	result.p95Ms = best.p95Ms;
+	result.feasible = isFeasible(best, objective);
+	return result;
+}
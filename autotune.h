@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+#include "corpus.h"
+#include "ocr.h"
+
+struct AutotuneObjective {
+	enum Metric { LatencyP95, LatencyP50, CharacterErrorRate };
+
+	Metric metric = LatencyP95;
+	double maxCer = 0.02;       // Constraint while minimizing latency
+	double maxLatencyMs = 0.0;  // p95 constraint while minimizing CER, 0 = none
+
+	static bool parseMetric(const QString& name, Metric& metric);
+};
+
+struct AutotuneResult {
+	OcrOptions options;
+	double cer = 1.0;
+	double p50Ms = 0.0;
+	double p95Ms = 0.0;
+	bool feasible = false;
+	int evaluations = 0;
+};
+
+// Coordinate descent over engine mode, page segmentation mode, scale,
+// preprocessing and a few engine variables, starting from the defaults.
+// Latency includes engine initialization, since the app starts a fresh
+// engine for every capture. Stops after maxEvaluations configurations or
+// when a full pass over all dimensions no longer improves the objective.
+AutotuneResult autotune(const QVector<CorpusSample>& samples, const QString& corpusDir,
+	const AutotuneObjective& objective, int maxEvaluations, QTextStream& log);
+
+// One line summary of the settings that differ from the defaults
+QString describeOptions(const OcrOptions& options);
@@ -0,0 +1,867 @@
+#include <tesseract/baseapi.h>
+// qt imports
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+#include "accuracy.h"
+#include "autotune.h"
+#include "benchreport.h"
+#include "bufferpool.h"
+#include "corpus.h"
+#include "kernels.h"
+#include "memstats.h"
+#include "ocr.h"
+#include "routing.h"
+#include "scripts.h"
+#include "trace.h"
+#include "traineddata.h"
+
+#ifndef OCR_BENCH_CORPUS_DIR
+#define OCR_BENCH_CORPUS_DIR ""
+#endif
+
+namespace {
+
+	double percentile(std::vector<double> values, double p) {
+		if (values.empty()) {
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		const double rank = p * (values.size() - 1);
+		const size_t lower = static_cast<size_t>(rank);
+		const size_t upper = std::min(lower + 1, values.size() - 1);
+		return values[lower] + (values[upper] - values[lower]) * (rank - lower);
+	}
+
+	QJsonObject latencyStats(const std::vector<double>& ms) {
+		double sum = 0.0;
+		for (double value : ms) {
+			sum += value;
+		}
+
+		QJsonObject stats;
+		stats["count"] = static_cast<qint64>(ms.size());
+		stats["mean_ms"] = ms.empty() ? 0.0 : sum / ms.size();
+		stats["p50_ms"] = percentile(ms, 0.50);
+		stats["p95_ms"] = percentile(ms, 0.95);
+		stats["min_ms"] = ms.empty() ? 0.0 : *std::min_element(ms.begin(), ms.end());
+		stats["max_ms"] = ms.empty() ? 0.0 : *std::max_element(ms.begin(), ms.end());
+		return stats;
+	}
+
+	// Folds the trace spans recorded during a run into per-stage statistics
+	QJsonObject stageStats() {
+		std::map<std::string, std::vector<double>> byStage;
+		for (const Trace::SpanRecord& span : Trace::takeSpans()) {
+			byStage[span.name].push_back(span.duration / 1000.0);
+		}
+
+		QJsonObject stages;
+		for (const auto& [name, durations] : byStage) {
+			stages[QString::fromStdString(name)] = latencyStats(durations);
+		}
+		return stages;
+	}
+
+	struct Run {
+		QString name;
+		std::vector<double> latencies;
+		QElapsedTimer wall;
+		int failures = 0;
+		QJsonObject extra;
+
+		BufferPool::Stats poolStart;
+		MemStats::Snapshot memoryStart;
+
+		explicit Run(const QString& runName) : name(runName) {
+			Trace::takeSpans();
+			MemStats::takeRecords();
+			poolStart = BufferPool::stats();
+			memoryStart = MemStats::snapshot();
+			wall.start();
+		}
+
+		QJsonObject toJson() {
+			const double wallMs = wall.nsecsElapsed() / 1e6;
+
+			QJsonObject run;
+			run["name"] = name;
+			run["calls"] = static_cast<qint64>(latencies.size());
+			run["failures"] = failures;
+			run["wall_ms"] = wallMs;
+			run["throughput_per_s"] = wallMs > 0.0 ? latencies.size() * 1000.0 / wallMs : 0.0;
+			run["latency"] = latencyStats(latencies);
+			run["stages"] = stageStats();
+			if (MemStats::isEnabled()) {
+				run["memory"] = MemStats::toJson(MemStats::takeRecords());
+				run["peak_rss_bytes"] = static_cast<qint64>(MemStats::processPeakRssBytes());
+				// Once warm, what each call still allocates
+				const MemStats::Snapshot memoryEnd = MemStats::snapshot();
+				run["allocations_per_call"] = latencies.empty() ? 0.0
+					: static_cast<double>(memoryEnd.allocations - memoryStart.allocations) / latencies.size();
+			}
+
+			const BufferPool::Stats poolEnd = BufferPool::stats();
+			QJsonObject pool;
+			pool["hits"] = static_cast<qint64>(poolEnd.hits - poolStart.hits);
+			pool["misses"] = static_cast<qint64>(poolEnd.misses - poolStart.misses);
+			pool["retained_bytes"] = static_cast<qint64>(poolEnd.retainedBytes);
+			run["buffer_pool"] = pool;
+			for (auto it = extra.constBegin(); it != extra.constEnd(); ++it) {
+				run[it.key()] = it.value();
+			}
+			return run;
+		}
+	};
+
+	double elapsedMs(const QElapsedTimer& timer) {
+		return timer.nsecsElapsed() / 1e6;
+	}
+
+	struct AccuracyTally {
+		ErrorCount characters;
+		ErrorCount words;
+		std::map<QString, std::pair<ErrorCount, ErrorCount>> byGroup;
+		QJsonArray samples;
+		bool keepSamples = false;
+
+		void add(const CorpusSample& sample, const QString& hypothesis) {
+			const ErrorCount cer = characterErrors(sample.text, hypothesis);
+			const ErrorCount wer = wordErrors(sample.text, hypothesis);
+			characters += cer;
+			words += wer;
+
+			// Real screenshots are reported separately; they are few but
+			// catch what the synthetic corpus cannot
+			const QString group = sample.sourcePath.isEmpty() ? sample.language : "real-" + sample.language;
+			byGroup[group].first += cer;
+			byGroup[group].second += wer;
+
+			if (keepSamples) {
+				QJsonObject entry;
+				entry["id"] = sample.id;
+				entry["cer"] = cer.rate();
+				entry["wer"] = wer.rate();
+				entry["text"] = hypothesis;
+				samples.append(entry);
+			}
+		}
+
+		static QJsonObject rates(const ErrorCount& cer, const ErrorCount& wer) {
+			QJsonObject object;
+			object["cer"] = cer.rate();
+			object["wer"] = wer.rate();
+			object["char_errors"] = cer.errors;
+			object["chars"] = cer.reference;
+			object["word_errors"] = wer.errors;
+			object["words"] = wer.reference;
+			return object;
+		}
+
+		QJsonObject toJson() const {
+			QJsonObject object = rates(characters, words);
+			QJsonObject groups;
+			for (const auto& [group, counts] : byGroup) {
+				groups[group] = rates(counts.first, counts.second);
+			}
+			object["by_language"] = groups;
+			if (keepSamples) {
+				object["samples"] = samples;
+			}
+			return object;
+		}
+	};
+
+	bool readReport(const QString& path, QJsonObject& report) {
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly)) {
+			return false;
+		}
+		const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+		report = document.object();
+		return document.isObject();
+	}
+
+	int compareMode(const QStringList& files, const CompareThresholds& thresholds) {
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+		if (files.size() != 2) {
+			err << "--compare takes a baseline and a candidate result file\n";
+			return 2;
+		}
+
+		QJsonObject baseline;
+		QJsonObject candidate;
+		if (!readReport(files[0], baseline) || !readReport(files[1], candidate)) {
+			err << "Failed to read benchmark results\n";
+			return 2;
+		}
+		return compareReports(baseline, candidate, thresholds, out) ? 0 : 1;
+	}
+
+	int autotuneMode(const QVector<CorpusSample>& corpus, const QString& corpusDir,
+		const AutotuneObjective& objective, int budget, const QString& profilePath) {
+		QTextStream err(stderr);
+
+		// Only tune on languages whose traineddata is installed
+		std::map<QString, bool> installed;
+		QVector<CorpusSample> samples;
+		for (const CorpusSample& sample : corpus) {
+			if (sample.isQrCode) {
+				continue;
+			}
+			if (!installed.count(sample.language)) {
+				tesseract::TessBaseAPI engine;
+				installed[sample.language] = engine.Init(nullptr, sample.language.toUtf8().constData()) == 0;
+				engine.End();
+				if (!installed[sample.language]) {
+					err << "Skipping " << sample.language << ": no traineddata\n";
+				}
+			}
+			if (installed[sample.language]) {
+				samples.append(sample);
+			}
+		}
+		if (samples.isEmpty()) {
+			err << "No text samples to tune on\n";
+			return 1;
+		}
+
+		err << "Tuning on " << samples.size() << " samples, at most " << budget << " configurations\n";
+		const AutotuneResult result = autotune(samples, corpusDir, objective, budget, err);
+		if (!result.feasible) {
+			err << "No configuration met the constraint; the profile was not written\n";
+			return 1;
+		}
+
+		if (!saveOcrProfile(profilePath, result.options)) {
+			err << "Failed to write " << profilePath << "\n";
+			return 1;
+		}
+
+		// Kept for reference, loadOcrProfile() ignores this group
+		QStringList languages;
+		for (const auto& [language, available] : installed) {
+			if (available) {
+				languages << language;
+			}
+		}
+		QSettings settings(profilePath, QSettings::IniFormat);
+		settings.beginGroup("autotune");
+		settings.setValue("languages", languages.join(','));
+		settings.setValue("samples", static_cast<int>(samples.size()));
+		settings.setValue("evaluations", result.evaluations);
+		settings.setValue("cer", result.cer);
+		settings.setValue("p50_ms", result.p50Ms);
+		settings.setValue("p95_ms", result.p95Ms);
+		settings.setValue("tesseract", tesseract::TessBaseAPI::Version());
+		settings.setValue("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+		settings.endGroup();
+
+		err << "Best: " << describeOptions(result.options) << " (CER "
+			<< QString::number(result.cer * 100.0, 'f', 2) << "%, p95 "
+			<< QString::number(result.p95Ms, 'f', 1) << " ms)\n"
+			<< "Wrote " << profilePath << "\n";
+		return 0;
+	}
+
+}
+
+int main(int argc, char* argv[]) {
+	// Rendering the corpus needs fonts but never a display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QGuiApplication app(argc, argv);
+	BufferPool::installForLeptonica();
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmark the QR and OCR paths on a synthetic screenshot corpus");
+	parser.addHelpOption();
+
+	QCommandLineOption langOption(
+		QStringList() << "lang",
+		"Comma-separated corpus languages (available: " + corpusLanguages().join(", ") + ").",
+		"languages", "eng");
+
+	QCommandLineOption samplesOption(
+		QStringList() << "samples",
+		"Render at most <n> samples, picked deterministically (0 = all).",
+		"n", "0");
+
+	QCommandLineOption seedOption(
+		QStringList() << "seed",
+		"Seed for sample selection.",
+		"seed", "24301");
+
+	QCommandLineOption iterationsOption(
+		QStringList() << "iterations",
+		"Passes over the corpus for the warm-engine run.",
+		"n", "1");
+
+	QCommandLineOption corpusDirOption(
+		QStringList() << "corpus-dir",
+		"Keep the rendered corpus in <dir> instead of a temporary directory.",
+		"dir");
+
+	QCommandLineOption outputOption(
+		QStringList() << "o" << "output",
+		"Write JSON results to <file> instead of stdout.",
+		"file");
+
+	QCommandLineOption noQrOption(
+		QStringList() << "no-qr",
+		"Skip the QR path.");
+
+	QCommandLineOption noColdOption(
+		QStringList() << "no-cold",
+		"Skip the cold-engine OCR run.");
+
+	QCommandLineOption noPipelineOption(
+		QStringList() << "no-pipeline",
+		"Skip the end-to-end run (QR first, then OCR with a fresh engine, as the app does).");
+
+	QCommandLineOption noMemOption(
+		QStringList() << "no-mem",
+		"Skip per-stage memory accounting (it reads /proc around every stage).");
+
+	QCommandLineOption realCorpusOption(
+		QStringList() << "real-corpus",
+		"Also run the checked-in screenshots under <dir>/<lang>/ (empty to disable).",
+		"dir", OCR_BENCH_CORPUS_DIR);
+
+	QCommandLineOption perSampleOption(
+		QStringList() << "per-sample",
+		"Include every sample's recognized text and error rates in the results.");
+
+	QCommandLineOption compareOption(
+		QStringList() << "compare",
+		"Compare two result files (baseline, candidate) instead of benchmarking. "
+		"Exits with 1 if accuracy or latency regressed.");
+
+	QCommandLineOption maxCerOption(
+		QStringList() << "max-cer-increase",
+		"Tolerated absolute CER increase for --compare.",
+		"rate", "0.002");
+
+	QCommandLineOption maxWerOption(
+		QStringList() << "max-wer-increase",
+		"Tolerated absolute WER increase for --compare.",
+		"rate", "0.01");
+
+	QCommandLineOption maxSlowdownOption(
+		QStringList() << "max-slowdown",
+		"Tolerated relative p50 latency increase for --compare.",
+		"ratio", "0.2");
+
+	QCommandLineOption profileOption(
+		QStringList() << "profile",
+		"Engine profile to benchmark with, or to write with --autotune (default for --autotune: "
+		+ defaultOcrProfilePath() + ").",
+		"file");
+
+	QCommandLineOption autotuneOption(
+		QStringList() << "autotune",
+		"Search engine mode, page segmentation, scale, preprocessing and engine variables "
+		"on the corpus and write the best settings to the profile the app loads.");
+
+	QCommandLineOption objectiveOption(
+		QStringList() << "objective",
+		"What --autotune minimizes: p95, p50 (latency including engine init) or cer.",
+		"metric", "p95");
+
+	QCommandLineOption tuneMaxCerOption(
+		QStringList() << "tune-max-cer",
+		"CER a configuration must stay within when --autotune minimizes latency.",
+		"rate", "0.02");
+
+	QCommandLineOption tuneMaxLatencyOption(
+		QStringList() << "tune-max-p95",
+		"p95 latency a configuration must stay within when --autotune minimizes CER (0 = none).",
+		"ms", "0");
+
+	QCommandLineOption tuneBudgetOption(
+		QStringList() << "tune-budget",
+		"Maximum number of configurations --autotune evaluates.",
+		"n", "60");
+
+	QCommandLineOption cascadeConfidenceOption(
+		QStringList() << "cascade-confidence",
+		"Line confidence below which the ocr-cascade run recognizes a line again with the best models "
+		"(default: the profile's, else 75).",
+		"percent");
+
+	parser.addOption(langOption);
+	parser.addOption(samplesOption);
+	parser.addOption(seedOption);
+	parser.addOption(iterationsOption);
+	parser.addOption(corpusDirOption);
+	parser.addOption(outputOption);
+	parser.addOption(noQrOption);
+	parser.addOption(noColdOption);
+	parser.addOption(noPipelineOption);
+	parser.addOption(noMemOption);
+	parser.addOption(realCorpusOption);
+	parser.addOption(perSampleOption);
+	parser.addOption(compareOption);
+	parser.addOption(maxCerOption);
+	parser.addOption(maxWerOption);
+	parser.addOption(maxSlowdownOption);
+	parser.addOption(profileOption);
+	parser.addOption(cascadeConfidenceOption);
+	parser.addOption(autotuneOption);
+	parser.addOption(objectiveOption);
+	parser.addOption(tuneMaxCerOption);
+	parser.addOption(tuneMaxLatencyOption);
+	parser.addOption(tuneBudgetOption);
+	parser.addPositionalArgument("files", "Result files for --compare.", "[baseline candidate]");
+	parser.process(app);
+
+	if (parser.isSet(compareOption)) {
+		CompareThresholds thresholds;
+		thresholds.maxCerIncrease = parser.value(maxCerOption).toDouble();
+		thresholds.maxWerIncrease = parser.value(maxWerOption).toDouble();
+		thresholds.maxSlowdown = parser.value(maxSlowdownOption).toDouble();
+		return compareMode(parser.positionalArguments(), thresholds);
+	}
+
+	QTextStream err(stderr);
+
+	CorpusOptions corpusOptions;
+	corpusOptions.languages = parser.value(langOption).split(',', Qt::SkipEmptyParts);
+	corpusOptions.includeQr = !parser.isSet(noQrOption);
+	corpusOptions.maxSamples = parser.value(samplesOption).toInt();
+	corpusOptions.seed = parser.value(seedOption).toUInt();
+	const int iterations = std::max(1, parser.value(iterationsOption).toInt());
+
+	QTemporaryDir tempDir;
+	const QString corpusDir = parser.isSet(corpusDirOption) ? parser.value(corpusDirOption) : tempDir.path();
+
+	QElapsedTimer renderTimer;
+	renderTimer.start();
+	QVector<CorpusSample> corpus = generateCorpus(corpusOptions);
+	if (corpus.isEmpty() || !writeCorpus(corpus, corpusDir)) {
+		err << "Failed to render the corpus into " << corpusDir << "\n";
+		return 1;
+	}
+	err << "Rendered " << corpus.size() << " samples in " << renderTimer.elapsed() << " ms\n";
+
+	int realSamples = 0;
+	if (!parser.value(realCorpusOption).isEmpty()) {
+		for (const CorpusSample& sample : loadCorpusDirectory(parser.value(realCorpusOption), corpusOptions.languages)) {
+			corpus.append(sample);
+			++realSamples;
+		}
+	}
+
+	if (parser.isSet(autotuneOption)) {
+		AutotuneObjective objective;
+		if (!AutotuneObjective::parseMetric(parser.value(objectiveOption), objective.metric)) {
+			err << "Unknown objective " << parser.value(objectiveOption) << "\n";
+			return 2;
+		}
+		objective.maxCer = parser.value(tuneMaxCerOption).toDouble();
+		objective.maxLatencyMs = parser.value(tuneMaxLatencyOption).toDouble();
+		const QString profilePath = parser.isSet(profileOption) ? parser.value(profileOption) : defaultOcrProfilePath();
+		return autotuneMode(corpus, corpusDir, objective, std::max(1, parser.value(tuneBudgetOption).toInt()), profilePath);
+	}
+
+	if (parser.isSet(profileOption) && !QFile::exists(parser.value(profileOption))) {
+		err << "No such profile: " << parser.value(profileOption) << "\n";
+		return 2;
+	}
+	const OcrOptions ocrOptions = loadOcrProfile(parser.value(profileOption));
+
+	Trace::enable();
+	if (!parser.isSet(noMemOption)) {
+		MemStats::enable();
+	}
+	QJsonArray runs;
+
+	if (!parser.isSet(noQrOption)) {
+		// Every sample goes through QR detection in the app, so text samples
+		// measure the miss path and QR samples the hit path
+		Run run("qr");
+		int hits = 0;
+		int correct = 0;
+		for (const CorpusSample& sample : corpus) {
+			QElapsedTimer timer;
+			timer.start();
+			const OcrResult result = detectQrCode(corpusImagePath(corpusDir, sample));
+			run.latencies.push_back(elapsedMs(timer));
+			if (result.success) {
+				++hits;
+				if (sample.isQrCode && result.text == sample.text) {
+					++correct;
+				}
+			}
+		}
+		run.extra["hits"] = hits;
+		run.extra["correct"] = correct;
+		runs.append(run.toJson());
+		err << "qr: " << hits << " hits\n";
+	}
+
+	QVector<CorpusSample> textSamples;
+	for (const CorpusSample& sample : corpus) {
+		if (!sample.isQrCode) {
+			textSamples.append(sample);
+		}
+	}
+
+	// Warm engines are initialized up front, which also tells us which
+	// languages have traineddata installed
+	std::map<QString, std::unique_ptr<tesseract::TessBaseAPI>> engines;
+	QJsonObject initTimes;
+	QJsonArray skippedLanguages;
+	const MemStats::RssBreakdown rssBeforeEngines = MemStats::rssBreakdown();
+	for (const QString& language : corpusOptions.languages) {
+		auto engine = std::make_unique<tesseract::TessBaseAPI>();
+		QElapsedTimer timer;
+		timer.start();
+		if (!initEngine(*engine, language, ocrOptions)) {
+			err << "Skipping " << language << ": no traineddata\n";
+			skippedLanguages.append(language);
+			continue;
+		}
+		initTimes[language] = elapsedMs(timer);
+		engines[language] = std::move(engine);
+	}
+
+	// What the warm engines hold once initialized; compare against a run
+	// with OCR_MMAP_TRAINEDDATA=0
+	const MemStats::RssBreakdown rssAfterEngines = MemStats::rssBreakdown();
+	QJsonObject engineMemory;
+	engineMemory["engines"] = static_cast<int>(engines.size());
+	engineMemory["traineddata_mmap"] = Traineddata::isEnabled() && !Traineddata::directory().isEmpty();
+	engineMemory["rss_anon_before_bytes"] = static_cast<qint64>(rssBeforeEngines.anonBytes);
+	engineMemory["rss_anon_after_bytes"] = static_cast<qint64>(rssAfterEngines.anonBytes);
+	engineMemory["rss_file_before_bytes"] = static_cast<qint64>(rssBeforeEngines.fileBytes);
+	engineMemory["rss_file_after_bytes"] = static_cast<qint64>(rssAfterEngines.fileBytes);
+	err << "Engines: RSS " << QString::number((rssBeforeEngines.anonBytes + rssBeforeEngines.fileBytes) / 1048576.0, 'f', 1)
+		<< " -> " << QString::number((rssAfterEngines.anonBytes + rssAfterEngines.fileBytes) / 1048576.0, 'f', 1)
+		<< " MiB (private " << QString::number((rssAfterEngines.anonBytes - rssBeforeEngines.anonBytes) / 1048576.0, 'f', 1)
+		<< " MiB more)\n";
+	Trace::takeSpans();
+	MemStats::takeRecords();
+
+	if (!parser.isSet(noColdOption)) {
+		// Mirrors the app: a fresh engine for every capture
+		Run run("ocr-cold");
+		AccuracyTally accuracy;
+		accuracy.keepSamples = parser.isSet(perSampleOption);
+		for (const CorpusSample& sample : textSamples) {
+			if (!engines.count(sample.language)) {
+				continue;
+			}
+			QElapsedTimer timer;
+			timer.start();
+			const OcrResult result = extractText(corpusImagePath(corpusDir, sample), sample.language, ocrOptions);
+			run.latencies.push_back(elapsedMs(timer));
+			if (!result.success) {
+				++run.failures;
+			}
+			accuracy.add(sample, result.text);
+		}
+		run.extra["accuracy"] = accuracy.toJson();
+		runs.append(run.toJson());
+		err << "ocr-cold: done\n";
+	}
+
+	if (!parser.isSet(noPipelineOption)) {
+		// The same decisions main() makes, scored against every sample's
+		// ground truth, QR payloads included
+		Run run("pipeline");
+		AccuracyTally accuracy;
+		accuracy.keepSamples = parser.isSet(perSampleOption);
+		for (const CorpusSample& sample : corpus) {
+			if (!sample.isQrCode && !engines.count(sample.language)) {
+				continue;
+			}
+			const QString imagePath = corpusImagePath(corpusDir, sample);
+			const QString language = sample.isQrCode ? corpusOptions.languages.first() : sample.language;
+
+			QElapsedTimer timer;
+			timer.start();
+			OcrResult result;
+			if (!parser.isSet(noQrOption)) {
+				result = detectQrCode(imagePath);
+			}
+			if (!result.success) {
+				result = extractText(imagePath, language, ocrOptions);
+			}
+			run.latencies.push_back(elapsedMs(timer));
+			if (!result.success) {
+				++run.failures;
+			}
+			accuracy.add(sample, result.text);
+		}
+		run.extra["accuracy"] = accuracy.toJson();
+		runs.append(run.toJson());
+		err << "pipeline: done\n";
+	}
+
+	{
+		Run run("ocr-warm");
+		run.extra["iterations"] = iterations;
+		run.extra["engine_init_ms"] = initTimes;
+		run.extra["engine_memory"] = engineMemory;
+		AccuracyTally accuracy;
+		accuracy.keepSamples = parser.isSet(perSampleOption);
+		for (int i = 0; i < iterations; ++i) {
+			for (const CorpusSample& sample : textSamples) {
+				auto engine = engines.find(sample.language);
+				if (engine == engines.end()) {
+					continue;
+				}
+				QElapsedTimer timer;
+				timer.start();
+				const OcrResult result = extractText(*engine->second, corpusImagePath(corpusDir, sample), ocrOptions);
+				run.latencies.push_back(elapsedMs(timer));
+				if (!result.success) {
+					++run.failures;
+				}
+				// Recognition is deterministic, so score the first pass only
+				if (i == 0) {
+					accuracy.add(sample, result.text);
+				}
+			}
+		}
+		run.extra["accuracy"] = accuracy.toJson();
+		runs.append(run.toJson());
+		err << "ocr-warm: done\n";
+	}
+
+	// With several languages, one combined engine against routing every
+	// block to the engine of its script, on the same samples
+	if (engines.size() < 2) {
+		err << "ocr-combined, ocr-routed: skipped, needs two installed languages\n";
+	}
+	else {
+		QStringList installed;
+		std::map<QString, std::unique_ptr<OcrEngine>> single;
+		for (const auto& engine : engines) {
+			installed << engine.first;
+			single[engine.first] = std::make_unique<OcrEngine>(engine.first, ocrOptions);
+			// Vertical blocks go to these, as in the app
+			const QString vertical = Routing::verticalLanguage(engine.first);
+			if (!vertical.isEmpty()) {
+				single[vertical] = std::make_unique<OcrEngine>(vertical, ocrOptions);
+			}
+		}
+		const QString combinedLanguage = installed.join('+');
+		OcrEngine combined(combinedLanguage, ocrOptions);
+		Scripts::Detector detector;
+		if (!detector.isValid()) {
+			err << "ocr-routed: blocks cannot be told apart without osd.traineddata, all go to "
+				<< installed.first() << "\n";
+		}
+
+		for (const bool routed : { false, true }) {
+			Run run(routed ? "ocr-routed" : "ocr-combined");
+			run.extra["iterations"] = iterations;
+			run.extra["languages"] = combinedLanguage;
+			AccuracyTally accuracy;
+			accuracy.keepSamples = parser.isSet(perSampleOption);
+			qint64 blocks = 0;
+			for (int i = 0; i < iterations; ++i) {
+				for (const CorpusSample& sample : textSamples) {
+					if (!engines.count(sample.language)) {
+						continue;
+					}
+					QElapsedTimer timer;
+					timer.start();
+					const QImage image = BufferPool::load(corpusImagePath(corpusDir, sample));
+					OcrResult result;
+					if (routed) {
+						const std::vector<Routing::Block> plan = Routing::plan(image, *single[installed.first()], &detector,
+							combinedLanguage);
+						result = Routing::recognize(image, plan, [&single](const QString& language) {
+							return single[language].get();
+							}, single[installed.first()].get());
+						if (i == 0) {
+							blocks += static_cast<qint64>(plan.size());
+						}
+					}
+					else {
+						result = combined.recognize(image);
+					}
+					run.latencies.push_back(elapsedMs(timer));
+					if (!result.success) {
+						++run.failures;
+					}
+					if (i == 0) {
+						accuracy.add(sample, result.text);
+					}
+				}
+			}
+			if (routed) {
+				run.extra["blocks"] = blocks;
+			}
+			run.extra["accuracy"] = accuracy.toJson();
+			runs.append(run.toJson());
+			err << run.name << ": done\n";
+		}
+	}
+
+	// The installed models above against tessdata_best alone and the two
+	// as a cascade, on the same samples
+	const QString bestDirectory = Traineddata::bestDirectory();
+	if (bestDirectory.isEmpty()) {
+		err << "ocr-best, ocr-cascade: skipped, no tessdata_best models (set OCR_TESSDATA_BEST_DIR)\n";
+	}
+	else {
+		OcrOptions cascadeOptions = ocrOptions;
+		if (parser.isSet(cascadeConfidenceOption)) {
+			cascadeOptions.cascadeConfidence = parser.value(cascadeConfidenceOption).toInt();
+		}
+		else if (cascadeOptions.cascadeConfidence <= 0) {
+			cascadeOptions.cascadeConfidence = 75;
+		}
+		OcrOptions bestOptions = ocrOptions;
+		bestOptions.cascadeConfidence = 0;
+
+		for (const bool cascade : { false, true }) {
+			std::map<QString, std::unique_ptr<OcrEngine>> tiered;
+			for (const auto& engine : engines) {
+				auto candidate = cascade
+					? std::make_unique<OcrEngine>(engine.first, cascadeOptions)
+					: std::make_unique<OcrEngine>(engine.first, bestOptions, bestDirectory);
+				if ((cascade && candidate->cascades()) || (!cascade && candidate->isValid())) {
+					tiered[engine.first] = std::move(candidate);
+				}
+				else {
+					err << (cascade ? "ocr-cascade" : "ocr-best") << ": skipping " << engine.first
+						<< ", not in " << bestDirectory << "\n";
+				}
+			}
+
+			Run run(cascade ? "ocr-cascade" : "ocr-best");
+			run.extra["iterations"] = iterations;
+			if (cascade) {
+				run.extra["cascade_confidence"] = cascadeOptions.cascadeConfidence;
+			}
+			AccuracyTally accuracy;
+			accuracy.keepSamples = parser.isSet(perSampleOption);
+			qint64 lines = 0;
+			qint64 escalated = 0;
+			for (int i = 0; i < iterations; ++i) {
+				for (const CorpusSample& sample : textSamples) {
+					auto engine = tiered.find(sample.language);
+					if (engine == tiered.end()) {
+						continue;
+					}
+					QElapsedTimer timer;
+					timer.start();
+					const OcrResult result = engine->second->recognize(corpusImagePath(corpusDir, sample));
+					run.latencies.push_back(elapsedMs(timer));
+					if (!result.success) {
+						++run.failures;
+					}
+					if (i == 0) {
+						accuracy.add(sample, result.text);
+						lines += result.lines;
+						escalated += result.escalatedLines;
+					}
+				}
+			}
+			if (cascade) {
+				run.extra["lines"] = lines;
+				run.extra["escalated_lines"] = escalated;
+				run.extra["escalated_fraction"] = lines > 0 ? static_cast<double>(escalated) / lines : 0.0;
+			}
+			run.extra["accuracy"] = accuracy.toJson();
+			runs.append(run.toJson());
+			err << run.name << ": done";
+			if (cascade) {
+				err << ", " << QString::number(lines > 0 ? escalated * 100.0 / lines : 0.0, 'f', 1)
+					<< "% of lines escalated";
+			}
+			err << "\n";
+		}
+	}
+
+	for (auto& engine : engines) {
+		engine.second->End();
+	}
+
+	QJsonArray fonts;
+	QStringList seenFonts;
+	for (const CorpusSample& sample : corpus) {
+		if (!sample.font.isEmpty() && !seenFonts.contains(sample.font)) {
+			seenFonts << sample.font;
+			fonts.append(sample.font);
+		}
+	}
+
+	QJsonObject environment;
+	environment["qt"] = qVersion();
+	environment["tesseract"] = tesseract::TessBaseAPI::Version();
+	environment["threads"] = QThread::idealThreadCount();
+	environment["kernels"] = Kernels::backendName(Kernels::backend());
+	environment["cpu_kernels"] = Kernels::backendName(Kernels::cpuBackend());
+
+	// Tesseract picks SIMD code for its network dot products on its own;
+	// "auto" means it chose from the same CPU features as we did
+	QString dotProduct = "unknown";
+	if (!engines.empty()) {
+		if (const char* value = engines.begin()->second->GetStringVariable("dotproduct")) {
+			dotProduct = value;
+		}
+	}
+	environment["tesseract_dotproduct"] = dotProduct;
+	if ((dotProduct == "generic" || dotProduct == "std::inner_product") && Kernels::cpuBackend() >= Kernels::Backend::Avx2) {
+		err << "Tesseract is set to the " << dotProduct << " dot product although the CPU supports "
+			<< Kernels::backendName(Kernels::cpuBackend()) << "\n";
+	}
+	environment["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+	QJsonObject corpusInfo;
+	corpusInfo["samples"] = static_cast<qint64>(corpus.size());
+	corpusInfo["text_samples"] = static_cast<qint64>(textSamples.size());
+	corpusInfo["real_samples"] = realSamples;
+	corpusInfo["seed"] = static_cast<qint64>(corpusOptions.seed);
+	corpusInfo["languages"] = QJsonArray::fromStringList(corpusOptions.languages);
+	corpusInfo["skipped_languages"] = skippedLanguages;
+	corpusInfo["fonts"] = fonts;
+
+	QJsonObject root;
+	root["benchmark"] = "ocr-bench";
+	root["format_version"] = 1;
+	root["environment"] = environment;
+	root["corpus"] = corpusInfo;
+	if (parser.isSet(profileOption)) {
+		root["profile"] = describeOptions(ocrOptions);
+	}
+	root["runs"] = runs;
+
+	const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+	if (parser.isSet(outputOption)) {
+		QFile file(parser.value(outputOption));
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			err << "Failed to write " << parser.value(outputOption) << "\n";
+			return 1;
+		}
+		file.write(json);
+	}
+	else {
+		QTextStream(stdout) << json;
+	}
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include "benchreport.h"
+
+#include <QJsonArray>
+#include <QStringList>
+
+namespace {
+
+	QJsonObject runsByName(const QJsonObject& report) {
+		QJsonObject runs;
+		for (const QJsonValue& run : report["runs"].toArray()) {
+			runs[run.toObject()["name"].toString()] = run;
+		}
+		return runs;
+	}
+
+	QString percentChange(double before, double after) {
+		if (before <= 0.0) {
+			return "n/a";
+		}
+		const double change = (after - before) / before * 100.0;
+		return QString("%1%2%").arg(change >= 0.0 ? "+" : "").arg(change, 0, 'f', 1);
+	}
+
+	QString rate(double value) {
+		return QString::number(value * 100.0, 'f', 2) + "%";
+	}
+
+}
+
+bool compareReports(const QJsonObject& baseline, const QJsonObject& candidate,
+	const CompareThresholds& thresholds, QTextStream& out) {
+	const QJsonObject baseRuns = runsByName(baseline);
+	const QJsonObject candidateRuns = runsByName(candidate);
+
+	bool ok = true;
+	for (const QString& name : baseRuns.keys()) {
+		if (!candidateRuns.contains(name)) {
+			out << name << ": missing from candidate\n";
+			continue;
+		}
+
+		const QJsonObject base = baseRuns[name].toObject();
+		const QJsonObject cand = candidateRuns[name].toObject();
+		const double baseP50 = base["latency"].toObject()["p50_ms"].toDouble();
+		const double candP50 = cand["latency"].toObject()["p50_ms"].toDouble();
+		const double baseP95 = base["latency"].toObject()["p95_ms"].toDouble();
+		const double candP95 = cand["latency"].toObject()["p95_ms"].toDouble();
+
+		QStringList problems;
+		const bool faster = candP50 < baseP50;
+		if (baseP50 > 0.0 && (candP50 - baseP50) / baseP50 > thresholds.maxSlowdown) {
+			problems << "slower";
+		}
+
+		out << name << ": p50 " << QString::number(baseP50, 'f', 1) << " -> " << QString::number(candP50, 'f', 1)
+			<< " ms (" << percentChange(baseP50, candP50) << "), p95 " << QString::number(baseP95, 'f', 1)
+			<< " -> " << QString::number(candP95, 'f', 1) << " ms (" << percentChange(baseP95, candP95) << ")";
+
+		if (base.contains("accuracy") && cand.contains("accuracy")) {
+			const QJsonObject baseAccuracy = base["accuracy"].toObject();
+			const QJsonObject candAccuracy = cand["accuracy"].toObject();
+			const double baseCer = baseAccuracy["cer"].toDouble();
+			const double candCer = candAccuracy["cer"].toDouble();
+			const double baseWer = baseAccuracy["wer"].toDouble();
+			const double candWer = candAccuracy["wer"].toDouble();
+
+			out << ", CER " << rate(baseCer) << " -> " << rate(candCer)
+				<< ", WER " << rate(baseWer) << " -> " << rate(candWer);
+
+			if (candCer - baseCer > thresholds.maxCerIncrease || candWer - baseWer > thresholds.maxWerIncrease) {
+				problems << (faster ? "speedup costs accuracy" : "less accurate");
+			}
+		}
+
+		if (problems.isEmpty()) {
+			out << "  ok\n";
+		}
+		else {
+			ok = false;
+			out << "  REGRESSION: " << problems.join(", ") << "\n";
+		}
+	}
+
+	return ok;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QTextStream>
+
+struct CompareThresholds {
+	double maxCerIncrease = 0.002;  // Absolute, 0.002 = 0.2 percentage points
+	double maxWerIncrease = 0.01;
+	double maxSlowdown = 0.20;      // Relative p50 increase
+};
+
+// Compares two ocr-bench result files run by run and prints a table. Returns
+// false if any run present in both lost accuracy or slowed down beyond the
+// thresholds; a faster run that loses accuracy is called out explicitly.
+bool compareReports(const QJsonObject& baseline, const QJsonObject& candidate,
+	const CompareThresholds& thresholds, QTextStream& out);
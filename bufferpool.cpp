@@ -0,0 +1,156 @@
+#include "bufferpool.h"
+
+#include <leptonica/allheaders.h>
+// qt imports
+#include <QImageReader>
+#include <QtGlobal>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace BufferPool {
+
+	namespace {
+
+		constexpr size_t kAlignment = 64;
+		// Below this malloc serves from its bins without fragmenting much
+		constexpr size_t kMinPooledSize = 64 * 1024;
+		constexpr size_t kMaxKeptPerClass = 4;
+
+		size_t retainLimit() {
+			static const size_t limit = [] {
+				bool ok = false;
+				const int mb = qEnvironmentVariableIntValue("OCR_BUFFER_POOL_MB", &ok);
+				return static_cast<size_t>(ok && mb >= 0 ? mb : 128) * 1024 * 1024;
+			}();
+			return limit;
+		}
+
+		// Rounds up to a quarter power of two, so a class wastes less than a
+		// fifth of its size and nearby image sizes share buffers
+		size_t sizeClass(size_t size) {
+			size_t power = kMinPooledSize;
+			while (power * 2 < size) {
+				power *= 2;
+			}
+			const size_t step = power / 4;
+			return (size + step - 1) / step * step;
+		}
+
+		std::mutex s_mutex;
+		std::map<size_t, std::vector<void*>> s_free;
+		std::unordered_map<void*, size_t> s_live;
+		Stats s_stats;
+
+		void cleanupImage(void* data) {
+			release(data);
+		}
+
+	}
+
+	void* allocate(size_t size) {
+		if (size < kMinPooledSize) {
+			return std::malloc(size);
+		}
+
+		const size_t bytes = sizeClass(size);
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			auto kept = s_free.find(bytes);
+			if (kept != s_free.end() && !kept->second.empty()) {
+				void* data = kept->second.back();
+				kept->second.pop_back();
+				s_live.emplace(data, bytes);
+				++s_stats.hits;
+				s_stats.retainedBytes -= static_cast<int64_t>(bytes);
+				s_stats.inUseBytes += static_cast<int64_t>(bytes);
+				return data;
+			}
+		}
+
+		void* data = std::aligned_alloc(kAlignment, bytes);
+		if (!data) {
+			return nullptr;
+		}
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_live.emplace(data, bytes);
+		++s_stats.misses;
+		s_stats.inUseBytes += static_cast<int64_t>(bytes);
+		return data;
+	}
+
+	void release(void* data) {
+		if (!data) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			auto live = s_live.find(data);
+			if (live != s_live.end()) {
+				const size_t bytes = live->second;
+				s_live.erase(live);
+				s_stats.inUseBytes -= static_cast<int64_t>(bytes);
+
+				std::vector<void*>& kept = s_free[bytes];
+				if (kept.size() < kMaxKeptPerClass && static_cast<size_t>(s_stats.retainedBytes) + bytes <= retainLimit()) {
+					kept.push_back(data);
+					s_stats.retainedBytes += static_cast<int64_t>(bytes);
+					return;
+				}
+			}
+		}
+		std::free(data);
+	}
+
+	QImage image(const QSize& size, QImage::Format format) {
+		if (size.isEmpty() || format == QImage::Format_Invalid) {
+			return QImage();
+		}
+
+		// QImage wants every line 32-bit aligned
+		const int depth = QImage::toPixelFormat(format).bitsPerPixel();
+		const qsizetype bytesPerLine = (static_cast<qsizetype>(size.width()) * depth + 31) / 32 * 4;
+		uchar* data = static_cast<uchar*>(allocate(static_cast<size_t>(bytesPerLine) * size.height()));
+		if (!data) {
+			return QImage();
+		}
+		return QImage(data, size.width(), size.height(), bytesPerLine, format, cleanupImage, data);
+	}
+
+	QImage load(const QString& path) {
+		// Decoders write into the image they are given when its size and
+		// format match what they are about to decode
+		QImageReader reader(path);
+		QImage image = BufferPool::image(reader.size(), reader.imageFormat());
+		if (!reader.read(&image)) {
+			return QImage();
+		}
+		return image;
+	}
+
+	void installForLeptonica() {
+		setPixMemoryManager(allocate, release);
+	}
+
+	void trim() {
+		std::map<size_t, std::vector<void*>> kept;
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			kept.swap(s_free);
+			s_stats.retainedBytes = 0;
+		}
+		for (const auto& [bytes, buffers] : kept) {
+			for (void* data : buffers) {
+				std::free(data);
+			}
+		}
+	}
+
+	Stats stats() {
+		std::lock_guard<std::mutex> lock(s_mutex);
+		return s_stats;
+	}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// qt imports
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+
+// Recycled image buffers. A resident process decodes, converts and
+// binarizes images of the same few sizes over and over; keeping freed
+// buffers by size class lets later captures reuse them instead of going
+// back to malloc, whose multi-MB blocks fragment the heap over a day.
+// Buffers are 64-byte aligned. At most OCR_BUFFER_POOL_MB (default 128)
+// is kept while unused.
+namespace BufferPool {
+
+	struct Stats {
+		uint64_t hits = 0;         // Allocations served from a kept buffer
+		uint64_t misses = 0;       // Allocations that went to malloc
+		int64_t inUseBytes = 0;
+		int64_t retainedBytes = 0;  // Kept for reuse
+	};
+
+	// Small requests are passed to malloc untracked; release() frees
+	// them, and anything else it does not know, with free()
+	void* allocate(size_t size);
+	void release(void* data);
+
+	// An image whose pixels come from the pool and go back to it when the
+	// last copy is gone
+	QImage image(const QSize& size, QImage::Format format);
+
+	// QImage::load() into a pooled buffer
+	QImage load(const QString& path);
+
+	// Routes Leptonica's pixel data through the pool, which also covers the
+	// copies Tesseract makes of every image. Call before any Pix exists.
+	void installForLeptonica();
+
+	// Frees every kept buffer
+	void trim();
+
+	Stats stats();
+
+}
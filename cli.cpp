@@ -0,0 +1,117 @@
+// qt imports
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <memory>
+#include "bufferpool.h"
+#include "ocr.h"
+
+// Headless front end: OCR for image files, text or JSON on stdout. The
+// engine is initialized once and reused for every image.
+int main(int argc, char* argv[]) {
+	QCoreApplication app(argc, argv);
+	// Images of a batch tend to share sizes, so their buffers are reused
+	BufferPool::installForLeptonica();
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Extract text from image files using OCR, without a window");
+	parser.addHelpOption();
+	parser.addPositionalArgument("images", "Image files to read.", "<image>...");
+
+	QCommandLineOption langOption(
+		QStringList() << "lang",
+		"Language(s) for OCR (e.g., eng, hin, or eng+hin for multiple languages)",
+		"language", "eng");
+
+	QCommandLineOption disable_qr(
+		QStringList() << "disable-qr",
+		"Disable QR code detection and extraction.");
+
+	QCommandLineOption profileOption(
+		QStringList() << "profile",
+		"Load engine settings written by ocr-bench --autotune from <file> (default: "
+		+ defaultOcrProfilePath() + " if it exists).",
+		"file");
+
+	QCommandLineOption jsonOption(
+		QStringList() << "json",
+		"Print one JSON object per image instead of the plain text.");
+
+	parser.addOption(langOption);
+	parser.addOption(disable_qr);
+	parser.addOption(profileOption);
+	parser.addOption(jsonOption);
+	parser.process(app);
+
+	const QStringList images = parser.positionalArguments();
+	if (images.isEmpty()) {
+		parser.showHelp(1);
+	}
+
+	const QString profilePath = parser.isSet(profileOption) ? parser.value(profileOption) : defaultOcrProfilePath();
+	if (parser.isSet(profileOption) && !QFile::exists(profilePath)) {
+		err << "No such profile: " << profilePath << ", using default settings\n";
+	}
+	const OcrOptions ocrOptions = loadOcrProfile(profilePath);
+	const QString language = parser.value(langOption);
+
+	// Created on first use, so a run that only finds QR codes never loads
+	// the language data
+	std::unique_ptr<OcrEngine> engine;
+
+	int failures = 0;
+	for (const QString& imagePath : images) {
+		// Only the header is read here; the image is decoded by path, so
+		// huge captures take the stripe path as in the app
+		QImageReader reader(imagePath);
+		OcrResult result;
+		if (!reader.canRead() || !reader.size().isValid()) {
+			result.errorMessage = "Failed to load image";
+		}
+		else {
+			if (!parser.isSet(disable_qr)) {
+				result = detectQrCode(imagePath);
+			}
+			if (!result.success) {
+				if (!engine) {
+					engine = std::make_unique<OcrEngine>(language, ocrOptions);
+				}
+				result = engine->recognize(imagePath);
+			}
+		}
+
+		if (!result.success) {
+			++failures;
+		}
+
+		if (parser.isSet(jsonOption)) {
+			QJsonObject line;
+			line["image"] = imagePath;
+			line["success"] = result.success;
+			line["qr"] = result.isQrCode;
+			line["text"] = result.text;
+			if (engine && engine->cascades() && !result.isQrCode) {
+				line["lines"] = result.lines;
+				line["escalated_lines"] = result.escalatedLines;
+			}
+			if (!result.success) {
+				line["error"] = result.errorMessage;
+			}
+			out << QJsonDocument(line).toJson(QJsonDocument::Compact) << "\n";
+		}
+		else if (result.success) {
+			out << result.text;
+		}
+		else {
+			err << imagePath << ": " << result.errorMessage << "\n";
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
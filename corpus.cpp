@@ -0,0 +1,328 @@
+#include "corpus.h"
+
+#include <ZXing/BitMatrix.h>
+#include <ZXing/MultiFormatWriter.h>
+// qt imports
+#include <QColor>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFont>
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QPainter>
+#include <QTextStream>
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+namespace {
+
+	struct SampleText {
+		const char* language;
+		bool cjk;
+		const char* text;
+	};
+
+	const SampleText kSampleTexts[] = {
+		{ "eng", false,
+			"The quick brown fox jumps over the lazy dog.\n"
+			"Invoice #4821 due 2024-03-15: $1,299.00\n"
+			"Settings > Display > Scale: 125%" },
+		{ "deu", false,
+			"Größere Änderungen werden erst nach dem Neustart übernommen.\n"
+			"Bitte überprüfen Sie Ihre Eingabe." },
+		{ "fra", false,
+			"Où se trouve la bibliothèque ? Ça dépend du quartier.\n"
+			"Dernière mise à jour : 12 février" },
+		{ "spa", false,
+			"¿Dónde está la estación de tren más cercana?\n"
+			"El señor pidió un café y una tostada." },
+		{ "jpn", true,
+			"吾輩は猫である。名前はまだ無い。\n"
+			"どこで生れたかとんと見当がつかぬ。" },
+		{ "chi_sim", true,
+			"这是一个用于文字识别的测试句子。\n"
+			"今天天气很好，我们去公园散步吧。" },
+	};
+
+	struct Theme {
+		const char* name;
+		QRgb foreground;
+		QRgb background;
+	};
+
+	const Theme kThemes[] = {
+		{ "light", qRgb(0x20, 0x20, 0x20), qRgb(0xff, 0xff, 0xff) },
+		{ "dark", qRgb(0xdc, 0xdc, 0xdc), qRgb(0x1e, 0x1e, 0x1e) },
+		{ "accent", qRgb(0xff, 0xff, 0xff), qRgb(0x34, 0x65, 0xa4) },
+	};
+
+	const int kPixelSizes[] = { 11, 14, 20 };
+	const qreal kDpiScales[] = { 1.0, 1.25, 2.0 };
+
+	const char* const kQrPayloads[] = {
+		"https://github.com/KienHoSD/spectacle-ocr-screenshot",
+		"WIFI:T:WPA;S:bench-network;P:correct horse battery staple;;",
+		"otpauth://totp/bench:user@example.org?secret=JBSWY3DPEHPK3PXP&issuer=bench",
+	};
+
+	const int kQrModuleSizes[] = { 3, 6 };
+
+	QStringList availableFonts(bool cjk) {
+		const QStringList candidates = cjk
+			? QStringList{ "Noto Sans CJK JP", "Noto Serif CJK JP", "Noto Sans CJK SC", "WenQuanYi Zen Hei" }
+			: QStringList{ "DejaVu Sans", "Noto Sans", "Liberation Serif", "DejaVu Sans Mono" };
+
+		QStringList fonts;
+		for (const QString& family : candidates) {
+			if (QFontDatabase::hasFamily(family)) {
+				fonts << family;
+			}
+		}
+		// Rely on Qt's fallback when none of the preferred families exist
+		if (fonts.isEmpty()) {
+			fonts << QFontDatabase::systemFont(QFontDatabase::GeneralFont).family();
+		}
+		return fonts;
+	}
+
+	QString slug(QString value) {
+		value = value.toLower();
+		for (QChar& c : value) {
+			if (!c.isLetterOrNumber()) {
+				c = '_';
+			}
+		}
+		return value;
+	}
+
+	void setDpi(QImage& image, qreal scale) {
+		// 96 dpi at 1x, written to the PNG pHYs chunk that Leptonica reads
+		const int dotsPerMeter = qRound(96.0 * scale / 0.0254);
+		image.setDotsPerMeterX(dotsPerMeter);
+		image.setDotsPerMeterY(dotsPerMeter);
+	}
+
+	QImage renderText(const QString& text, const QString& family, int pixelSize,
+		const Theme& theme, qreal scale) {
+		QFont font(family);
+		font.setPixelSize(qRound(pixelSize * scale));
+
+		const QStringList lines = text.split('\n');
+		const QFontMetrics metrics(font);
+		int textWidth = 0;
+		for (const QString& line : lines) {
+			textWidth = std::max(textWidth, metrics.horizontalAdvance(line));
+		}
+
+		const int padding = qRound(12 * scale);
+		const int lineHeight = metrics.lineSpacing();
+		QImage image(textWidth + 2 * padding, lineHeight * lines.size() + 2 * padding,
+			QImage::Format_RGB32);
+		image.fill(QColor::fromRgb(theme.background));
+		setDpi(image, scale);
+
+		QPainter painter(&image);
+		painter.setRenderHint(QPainter::TextAntialiasing);
+		painter.setFont(font);
+		painter.setPen(QColor::fromRgb(theme.foreground));
+		int baseline = padding + metrics.ascent();
+		for (const QString& line : lines) {
+			painter.drawText(padding, baseline, line);
+			baseline += lineHeight;
+		}
+		painter.end();
+
+		return image;
+	}
+
+	QImage renderQrCode(const QString& payload, int moduleSize, const Theme& theme,
+		const QString& family) {
+		const ZXing::BitMatrix matrix =
+			ZXing::MultiFormatWriter(ZXing::BarcodeFormat::QRCode).setMargin(0)
+				.encode(payload.toStdWString(), 0, 0);
+
+		// Place the code on a screenshot-like canvas with a caption, keeping
+		// the four-module quiet zone the spec requires
+		const int quietZone = 4 * moduleSize;
+		const int codeSize = matrix.width() * moduleSize;
+		const int padding = 24;
+		const int captionHeight = 32;
+		QImage image(codeSize + 2 * (quietZone + padding),
+			codeSize + 2 * (quietZone + padding) + captionHeight, QImage::Format_RGB32);
+		image.fill(QColor::fromRgb(theme.background));
+		setDpi(image, 1.0);
+
+		QPainter painter(&image);
+		painter.fillRect(QRect(padding, padding, codeSize + 2 * quietZone, codeSize + 2 * quietZone),
+			Qt::white);
+		for (int y = 0; y < matrix.height(); ++y) {
+			for (int x = 0; x < matrix.width(); ++x) {
+				if (matrix.get(x, y)) {
+					painter.fillRect(QRect(padding + quietZone + x * moduleSize,
+						padding + quietZone + y * moduleSize, moduleSize, moduleSize), Qt::black);
+				}
+			}
+		}
+
+		QFont font(family);
+		font.setPixelSize(14);
+		painter.setFont(font);
+		painter.setPen(QColor::fromRgb(theme.foreground));
+		painter.drawText(QRect(0, image.height() - padding - captionHeight, image.width(), captionHeight),
+			Qt::AlignCenter, "Scan to continue");
+		painter.end();
+
+		return image;
+	}
+
+}
+
+QStringList corpusLanguages() {
+	QStringList languages;
+	for (const SampleText& sample : kSampleTexts) {
+		languages << sample.language;
+	}
+	return languages;
+}
+
+QVector<CorpusSample> generateCorpus(const CorpusOptions& options) {
+	// Enumerate the parameter space first and render only what is kept, so
+	// subsampling stays cheap and the selection is independent of rendering
+	struct Spec {
+		const SampleText* text = nullptr;
+		int qrPayload = -1;
+		QString font;
+		int size = 0;
+		const Theme* theme = nullptr;
+		qreal scale = 1.0;
+	};
+
+	QVector<Spec> specs;
+	for (const SampleText& text : kSampleTexts) {
+		if (!options.languages.contains(text.language)) {
+			continue;
+		}
+		for (const QString& font : availableFonts(text.cjk)) {
+			for (int size : kPixelSizes) {
+				for (const Theme& theme : kThemes) {
+					for (qreal scale : kDpiScales) {
+						specs.append({ &text, -1, font, size, &theme, scale });
+					}
+				}
+			}
+		}
+	}
+	if (options.includeQr) {
+		const QString captionFont = availableFonts(false).first();
+		for (int payload = 0; payload < int(std::size(kQrPayloads)); ++payload) {
+			for (int moduleSize : kQrModuleSizes) {
+				for (const Theme& theme : kThemes) {
+					specs.append({ nullptr, payload, captionFont, moduleSize, &theme, 1.0 });
+				}
+			}
+		}
+	}
+
+	if (options.maxSamples > 0 && options.maxSamples < specs.size()) {
+		// Hand-rolled Fisher-Yates: std::shuffle is free to differ between
+		// standard libraries, mt19937's output sequence is not
+		std::mt19937 rng(options.seed);
+		for (int i = static_cast<int>(specs.size()) - 1; i > 0; --i) {
+			const int j = static_cast<int>(rng() % static_cast<quint32>(i + 1));
+			std::swap(specs[i], specs[j]);
+		}
+		specs.resize(options.maxSamples);
+	}
+
+	QVector<CorpusSample> samples;
+	samples.reserve(specs.size());
+	for (const Spec& spec : specs) {
+		CorpusSample sample;
+		sample.font = spec.font;
+		sample.theme = spec.theme->name;
+		sample.dpiScale = spec.scale;
+		if (spec.text) {
+			sample.language = spec.text->language;
+			sample.text = QString::fromUtf8(spec.text->text);
+			sample.pixelSize = spec.size;
+			sample.id = QString("%1-%2-%3px-%4-%5x")
+				.arg(sample.language, slug(sample.font))
+				.arg(sample.pixelSize)
+				.arg(sample.theme)
+				.arg(sample.dpiScale);
+			sample.image = renderText(sample.text, sample.font, sample.pixelSize, *spec.theme, spec.scale);
+		}
+		else {
+			sample.isQrCode = true;
+			sample.text = QString::fromUtf8(kQrPayloads[spec.qrPayload]);
+			sample.pixelSize = spec.size;
+			sample.id = QString("qr%1-%2px-%3")
+				.arg(spec.qrPayload)
+				.arg(sample.pixelSize)
+				.arg(sample.theme);
+			sample.image = renderQrCode(sample.text, spec.size, *spec.theme, sample.font);
+		}
+		samples.append(sample);
+	}
+
+	std::sort(samples.begin(), samples.end(), [](const CorpusSample& a, const CorpusSample& b) {
+		return a.id < b.id;
+	});
+	return samples;
+}
+
+QVector<CorpusSample> loadCorpusDirectory(const QString& directory, const QStringList& languages) {
+	QVector<CorpusSample> samples;
+	const QDir root(directory);
+	for (const QString& language : languages) {
+		const QDir languageDir(root.filePath(language));
+		for (const QString& fileName : languageDir.entryList(QStringList() << "*.png", QDir::Files, QDir::Name)) {
+			const QString baseName = QFileInfo(fileName).completeBaseName();
+			QFile truth(languageDir.filePath(baseName + ".gt.txt"));
+			if (!truth.open(QIODevice::ReadOnly | QIODevice::Text)) {
+				continue;
+			}
+
+			CorpusSample sample;
+			sample.id = "real-" + language + "-" + baseName;
+			sample.language = language;
+			sample.text = QString::fromUtf8(truth.readAll()).trimmed();
+			sample.theme = "real";
+			sample.sourcePath = languageDir.filePath(fileName);
+			samples.append(sample);
+		}
+	}
+	return samples;
+}
+
+QString corpusImagePath(const QString& directory, const CorpusSample& sample) {
+	if (!sample.sourcePath.isEmpty()) {
+		return sample.sourcePath;
+	}
+	return QDir(directory).filePath(sample.id + ".png");
+}
+
+bool writeCorpus(const QVector<CorpusSample>& samples, const QString& directory) {
+	if (!QDir().mkpath(directory)) {
+		return false;
+	}
+
+	for (const CorpusSample& sample : samples) {
+		if (!sample.sourcePath.isEmpty()) {
+			continue;
+		}
+		if (!sample.image.save(corpusImagePath(directory, sample), "PNG")) {
+			return false;
+		}
+
+		QFile truth(QDir(directory).filePath(sample.id + ".gt.txt"));
+		if (!truth.open(QIODevice::WriteOnly | QIODevice::Text)) {
+			return false;
+		}
+		QTextStream out(&truth);
+		out << sample.text << "\n";
+	}
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A synthetic screenshot with its ground truth
+struct CorpusSample {
+	QString id;
+	QString language;  // Tesseract language code, empty for QR samples
+	QString text;
+	QString font;
+	int pixelSize = 0;
+	QString theme;
+	qreal dpiScale = 1.0;
+	bool isQrCode = false;
+	QImage image;
+	// Set for checked-in screenshots, which are used as they are on disk
+	QString sourcePath;
+};
+
+struct CorpusOptions {
+	QStringList languages = { "eng" };
+	bool includeQr = true;
+	// 0 keeps the full cross product of fonts, sizes, themes and scales
+	int maxSamples = 0;
+	quint32 seed = 0x5eed;
+};
+
+// Languages that have built-in sample text
+QStringList corpusLanguages();
+
+// Renders the corpus with QPainter; needs a QGuiApplication for fonts. The
+// output only depends on the options and the installed fonts.
+QVector<CorpusSample> generateCorpus(const CorpusOptions& options);
+
+// Loads <dir>/<language>/<name>.png with a <name>.gt.txt transcript next
+// to it, as used for the real screenshots in bench/corpus
+QVector<CorpusSample> loadCorpusDirectory(const QString& directory, const QStringList& languages);
+
+// Writes <id>.png and <id>.gt.txt for every rendered sample
+bool writeCorpus(const QVector<CorpusSample>& samples, const QString& directory);
+
+QString corpusImagePath(const QString& directory, const CorpusSample& sample);
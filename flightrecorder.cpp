@@ -0,0 +1,385 @@
+#include "flightrecorder.h"
+
+// qt imports
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace.h"
+
+namespace FlightRecorder {
+
+	namespace {
+
+		constexpr char kMagic[8] = { 'O', 'C', 'R', 'F', 'L', 'I', 'G', 'H' };
+		constexpr uint32_t kVersion = 1;
+		constexpr uint32_t kCapacity = 64;
+		constexpr int kMaxStages = 16;
+
+		enum Flags : uint8_t {
+			Success = 1 << 0,
+			QrCode = 1 << 1,
+			EngineReused = 1 << 2,
+		};
+
+		struct Stage {
+			char name[23];
+			uint8_t depth;
+			uint32_t startUs;     // From the start of the capture
+			uint32_t durationUs;
+		};
+
+		// Plain data only; it is shared between processes through the file
+		struct Record {
+			int64_t wallClockMs;
+			int32_t pid;
+			int32_t imageWidth;
+			int32_t imageHeight;
+			int32_t resultChars;
+			uint32_t totalUs;
+			uint8_t flags;
+			uint8_t stageCount;
+			uint8_t droppedStages;
+			char language[29];
+			Stage stages[kMaxStages];
+		};
+
+		// Even and non-zero once the record for ring position (sequence - 2) / 2
+		// is complete, odd while it is being written
+		struct Slot {
+			std::atomic<uint64_t> sequence;
+			Record record;
+		};
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t capacity;
+			uint32_t slotSize;
+			uint32_t reserved;
+			std::atomic<uint64_t> next;
+		};
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring is shared between processes");
+
+		constexpr size_t kFileSize = sizeof(Header) + kCapacity * sizeof(Slot);
+
+		Header* s_header = nullptr;
+		Slot* s_slots = nullptr;
+
+		bool isCompatible(const Header* header) {
+			return std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 && header->version == kVersion
+				&& header->capacity == kCapacity && header->slotSize == sizeof(Slot);
+		}
+
+		// Maps the file; the flock only serializes creation between processes
+		void* mapRing(const QString& path, bool create) {
+			const int fd = ::open(QFile::encodeName(path).constData(), (create ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0600);
+			if (fd < 0) {
+				return nullptr;
+			}
+
+			void* memory = nullptr;
+			if (create) {
+				::flock(fd, LOCK_EX);
+				struct stat info;
+				const bool fresh = ::fstat(fd, &info) != 0 || info.st_size != static_cast<off_t>(kFileSize);
+				if (!fresh || ::ftruncate(fd, kFileSize) == 0) {
+					memory = ::mmap(nullptr, kFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				}
+				if (memory != MAP_FAILED && memory) {
+					Header* header = static_cast<Header*>(memory);
+					if (fresh || !isCompatible(header)) {
+						std::memset(memory, 0, kFileSize);
+						std::memcpy(header->magic, kMagic, sizeof(kMagic));
+						header->version = kVersion;
+						header->capacity = kCapacity;
+						header->slotSize = sizeof(Slot);
+					}
+				}
+				::flock(fd, LOCK_UN);
+			}
+			else {
+				struct stat info;
+				if (::fstat(fd, &info) == 0 && info.st_size == static_cast<off_t>(kFileSize)) {
+					memory = ::mmap(nullptr, kFileSize, PROT_READ, MAP_SHARED, fd, 0);
+				}
+			}
+			::close(fd);
+			return memory == MAP_FAILED ? nullptr : memory;
+		}
+
+		void copyName(char* target, size_t size, const char* source) {
+			std::strncpy(target, source, size - 1);
+			target[size - 1] = '\0';
+		}
+
+	}
+
+	struct PendingCapture {
+		Record record = {};
+		int64_t startUs = 0;
+		int openStages[kMaxStages];
+		int depth = 0;
+		bool committed = false;
+	};
+
+	namespace {
+
+		thread_local PendingCapture* t_pending = nullptr;
+
+		void beginStage(const char* name) {
+			PendingCapture* pending = t_pending;
+			if (!pending) {
+				return;
+			}
+			Record& record = pending->record;
+			int index = -1;
+			if (record.stageCount < kMaxStages) {
+				index = record.stageCount++;
+				Stage& stage = record.stages[index];
+				copyName(stage.name, sizeof(stage.name), name);
+				stage.depth = static_cast<uint8_t>(pending->depth);
+				stage.startUs = static_cast<uint32_t>(Trace::now() - pending->startUs);
+			}
+			else if (record.droppedStages < 255) {
+				++record.droppedStages;
+			}
+			if (pending->depth < kMaxStages) {
+				pending->openStages[pending->depth] = index;
+			}
+			++pending->depth;
+		}
+
+		void endStage(const char*) {
+			PendingCapture* pending = t_pending;
+			if (!pending || pending->depth == 0) {
+				return;
+			}
+			--pending->depth;
+			const int index = pending->depth < kMaxStages ? pending->openStages[pending->depth] : -1;
+			if (index >= 0) {
+				Stage& stage = pending->record.stages[index];
+				stage.durationUs = static_cast<uint32_t>(Trace::now() - pending->startUs) - stage.startUs;
+			}
+		}
+
+		Trace::SpanHooks s_hooks = { &beginStage, &endStage };
+
+		int s_signalPipe[2] = { -1, -1 };
+
+		void onDumpSignal(int) {
+			const char byte = 1;
+			const int savedErrno = errno;
+			(void)!::write(s_signalPipe[0], &byte, 1);
+			errno = savedErrno;
+		}
+
+		QJsonObject recordToJson(uint64_t position, const Record& record) {
+			QJsonArray stages;
+			for (int i = 0; i < record.stageCount && i < kMaxStages; ++i) {
+				const Stage& stage = record.stages[i];
+				QJsonObject object;
+				object["name"] = QString::fromLatin1(stage.name, static_cast<int>(strnlen(stage.name, sizeof(stage.name))));
+				object["depth"] = stage.depth;
+				object["start_ms"] = stage.startUs / 1000.0;
+				object["duration_ms"] = stage.durationUs / 1000.0;
+				stages.append(object);
+			}
+
+			QJsonObject capture;
+			capture["sequence"] = static_cast<qint64>(position);
+			capture["time"] = QDateTime::fromMSecsSinceEpoch(record.wallClockMs).toString(Qt::ISODateWithMs);
+			capture["pid"] = record.pid;
+			capture["language"] = QString::fromUtf8(record.language, static_cast<int>(strnlen(record.language, sizeof(record.language))));
+			capture["image"] = QJsonObject{ { "width", record.imageWidth }, { "height", record.imageHeight } };
+			capture["path"] = (record.flags & QrCode) ? "qr" : "ocr";
+			capture["success"] = (record.flags & Success) != 0;
+			capture["engine_reused"] = (record.flags & EngineReused) != 0;
+			capture["result_chars"] = record.resultChars;
+			capture["total_ms"] = record.totalUs / 1000.0;
+			capture["stages"] = stages;
+			if (record.droppedStages > 0) {
+				capture["dropped_stages"] = record.droppedStages;
+			}
+			return capture;
+		}
+
+	}
+
+	QString defaultPath() {
+		QString directory = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+		if (directory.isEmpty()) {
+			directory = QDir::tempPath();
+		}
+		return directory + "/spectacle-ocr-screenshot-flight-recorder.bin";
+	}
+
+	bool open(const QString& path) {
+		if (s_header) {
+			return true;
+		}
+		void* memory = mapRing(path, true);
+		if (!memory) {
+			return false;
+		}
+		s_header = static_cast<Header*>(memory);
+		s_slots = reinterpret_cast<Slot*>(static_cast<char*>(memory) + sizeof(Header));
+		Trace::addSpanHooks(&s_hooks);
+		return true;
+	}
+
+	QJsonObject dump(const QString& path) {
+		QJsonObject root;
+		root["recorder"] = "flight-recorder";
+		root["file"] = path;
+
+		void* memory = mapRing(path, false);
+		const Header* header = static_cast<const Header*>(memory);
+		if (!memory || !isCompatible(header)) {
+			if (memory) {
+				::munmap(memory, kFileSize);
+			}
+			root["captures"] = QJsonArray();
+			return root;
+		}
+		const Slot* slots = reinterpret_cast<const Slot*>(static_cast<const char*>(memory) + sizeof(Header));
+
+		// Seqlock read: a slot that changed while it was copied is skipped
+		std::vector<std::pair<uint64_t, Record>> records;
+		for (uint32_t i = 0; i < kCapacity; ++i) {
+			const uint64_t before = slots[i].sequence.load(std::memory_order_acquire);
+			if (before == 0 || (before & 1)) {
+				continue;
+			}
+			Record copy;
+			std::memcpy(&copy, &slots[i].record, sizeof(Record));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slots[i].sequence.load(std::memory_order_relaxed) == before) {
+				records.emplace_back((before - 2) / 2, copy);
+			}
+		}
+		std::sort(records.begin(), records.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
+
+		QJsonArray captures;
+		for (const auto& [position, record] : records) {
+			captures.append(recordToJson(position, record));
+		}
+		root["capacity"] = static_cast<qint64>(kCapacity);
+		root["captures"] = captures;
+		::munmap(memory, kFileSize);
+		return root;
+	}
+
+	void installDumpSignal() {
+		if (s_signalPipe[0] >= 0 || ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, s_signalPipe) != 0) {
+			return;
+		}
+
+		// Qt may only be used outside the handler, so it just wakes the event loop
+		auto* notifier = new QSocketNotifier(s_signalPipe[1], QSocketNotifier::Read, QCoreApplication::instance());
+		QObject::connect(notifier, &QSocketNotifier::activated, [notifier]() {
+			char byte;
+			(void)!::read(s_signalPipe[1], &byte, 1);
+
+			const QString path = QString("%1.%2.json").arg(defaultPath()).arg(::getpid());
+			QFile file(path);
+			QTextStream err(stderr);
+			if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+				file.write(QJsonDocument(dump()).toJson(QJsonDocument::Indented));
+				err << "Flight recorder written to " << path << "\n";
+			}
+			else {
+				err << "Failed to write " << path << "\n";
+			}
+			});
+
+		struct sigaction action = {};
+		action.sa_handler = &onDumpSignal;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = SA_RESTART;
+		::sigaction(SIGUSR1, &action, nullptr);
+	}
+
+	Capture::Capture(const QString& language) {
+		if (!s_header || t_pending) {
+			return;
+		}
+		m_pending = std::make_unique<PendingCapture>();
+		m_pending->startUs = Trace::now();
+		m_pending->record.wallClockMs = QDateTime::currentMSecsSinceEpoch();
+		m_pending->record.pid = static_cast<int32_t>(::getpid());
+		copyName(m_pending->record.language, sizeof(m_pending->record.language), language.toUtf8().constData());
+		t_pending = m_pending.get();
+	}
+
+	Capture::~Capture() {
+		commit();
+	}
+
+	void Capture::setImageSize(int width, int height) {
+		if (m_pending) {
+			m_pending->record.imageWidth = width;
+			m_pending->record.imageHeight = height;
+		}
+	}
+
+	void Capture::setEngineReused(bool reused) {
+		if (m_pending && reused) {
+			m_pending->record.flags |= EngineReused;
+		}
+	}
+
+	void Capture::setResult(const OcrResult& result) {
+		if (!m_pending) {
+			return;
+		}
+		Record& record = m_pending->record;
+		record.resultChars = result.text.size();
+		record.flags = (record.flags & EngineReused) | (result.success ? Success : 0) | (result.isQrCode ? QrCode : 0);
+	}
+
+	void Capture::commit() {
+		if (!m_pending || m_pending->committed) {
+			return;
+		}
+		m_pending->committed = true;
+		t_pending = nullptr;
+
+		Record& record = m_pending->record;
+		record.totalUs = static_cast<uint32_t>(Trace::now() - m_pending->startUs);
+		// Stages still open at commit time end here
+		for (int depth = 0; depth < std::min(m_pending->depth, kMaxStages); ++depth) {
+			const int index = m_pending->openStages[depth];
+			if (index >= 0) {
+				record.stages[index].durationUs = record.totalUs - record.stages[index].startUs;
+			}
+		}
+
+		const uint64_t position = s_header->next.fetch_add(1, std::memory_order_relaxed);
+		Slot& slot = s_slots[position % kCapacity];
+		slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(&slot.record, &record, sizeof(Record));
+		slot.sequence.store(2 * position + 2, std::memory_order_release);
+	}
+
+}
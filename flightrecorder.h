@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include "ocr.h"
+
+// Always-on record of the last captures: stage timings, image size,
+// language, engine reuse and result size. Records live in a fixed-size ring
+// in a memory-mapped file under $XDG_RUNTIME_DIR that every process shares,
+// so a slow capture can still be looked at after the process that made it
+// has exited. Writers claim slots with one atomic increment and publish
+// them with a per-slot sequence number; nothing ever blocks.
+namespace FlightRecorder {
+
+	QString defaultPath();
+
+	// Maps the ring, creating it if needed, and starts collecting stages
+	// from trace spans. Recording stays off if the file cannot be mapped.
+	bool open(const QString& path = defaultPath());
+
+	// All complete records in the ring, oldest first. Works without open().
+	QJsonObject dump(const QString& path = defaultPath());
+
+	// Writes dump() as JSON to <ring>.<pid>.json whenever the process
+	// receives SIGUSR1. Needs a running Qt event loop.
+	void installDumpSignal();
+
+	struct PendingCapture;
+
+	// One capture on the calling thread; spans that run on this thread while
+	// it exists become its stages. Committed on commit() or destruction.
+	class Capture {
+	public:
+		explicit Capture(const QString& language);
+		~Capture();
+
+		Capture(const Capture&) = delete;
+		Capture& operator=(const Capture&) = delete;
+
+		void setImageSize(int width, int height);
+		void setEngineReused(bool reused);
+		void setResult(const OcrResult& result);
+
+		void commit();
+
+	private:
+		std::unique_ptr<PendingCapture> m_pending;
+	};
+
+}
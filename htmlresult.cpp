@@ -0,0 +1,112 @@
+#include "htmlresult.h"
+
+// qt imports
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include "trace.h"
+
+QString writeResultHtml(const QString& text) {
+	TRACE_SCOPE("html.write");
+	QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
+	QString htmlPath = QDir::tempPath() + "/ocr_result_" + timestamp + ".html";
+
+	QFile file(htmlPath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+		return QString();
+	}
+
+	QTextStream out(&file);
+	out << "<!DOCTYPE html>\n"
+		<< "<html lang=\"en\">\n"
+		<< "<head>\n"
+		<< "    <meta charset=\"UTF-8\">\n"
+		<< "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+		<< "    <title>OCR Results</title>\n"
+		<< "    <style>\n"
+		<< "        body {\n"
+		<< "            font-family: Arial, sans-serif;\n"
+		<< "            margin: 20px;\n"
+		<< "            line-height: 1.6;\n"
+		<< "            background-color: #f4f4f4;\n"
+		<< "        }\n"
+		<< "        .container {\n"
+		<< "            max-width: 800px;\n"
+		<< "            margin: 0 auto;\n"
+		<< "            background-color: white;\n"
+		<< "            padding: 20px;\n"
+		<< "            border-radius: 8px;\n"
+		<< "            box-shadow: 0 2px 4px rgba(0,0,0,0.1);\n"
+		<< "        }\n"
+		<< "        h1 {\n"
+		<< "            color: #333;\n"
+		<< "        }\n"
+		<< "        .timestamp {\n"
+		<< "            color: #666;\n"
+		<< "            font-size: 0.9em;\n"
+		<< "        }\n"
+		<< "        .content {\n"
+		<< "            width: 100%;\n"
+		<< "            min-height: 300px;\n"
+		<< "            padding: 15px;\n"
+		<< "            border: 2px solid #007bff;\n"
+		<< "            border-radius: 4px;\n"
+		<< "            font-family: 'Courier New', monospace;\n"
+		<< "            font-size: 14px;\n"
+		<< "            box-sizing: border-box;\n"
+		<< "            resize: vertical;\n"
+		<< "        }\n"
+		<< "        .button-group {\n"
+		<< "            margin-top: 15px;\n"
+		<< "            display: flex;\n"
+		<< "            gap: 10px;\n"
+		<< "        }\n"
+		<< "        button {\n"
+		<< "            padding: 10px 20px;\n"
+		<< "            background-color: #007bff;\n"
+		<< "            color: white;\n"
+		<< "            border: none;\n"
+		<< "            border-radius: 4px;\n"
+		<< "            cursor: pointer;\n"
+		<< "            font-size: 14px;\n"
+		<< "        }\n"
+		<< "        button:hover {\n"
+		<< "            background-color: #0056b3;\n"
+		<< "        }\n"
+		<< "    </style>\n"
+		<< "</head>\n"
+		<< "<body>\n"
+		<< "    <div class=\"container\">\n"
+		<< "        <h1>OCR Results</h1>\n"
+		<< "        <p class=\"timestamp\">Generated: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << "</p>\n"
+		<< "        <textarea id=\"content\" class=\"content\">" << text.toHtmlEscaped() << "</textarea>\n"
+		<< "        <div class=\"button-group\">\n"
+		<< "            <button onclick=\"copyText()\">Copy to Clipboard</button>\n"
+		<< "            <button onclick=\"downloadText()\">Download as TXT</button>\n"
+		<< "        </div>\n"
+		<< "    </div>\n"
+		<< "    <script>\n"
+		<< "        function copyText() {\n"
+		<< "            const textarea = document.getElementById('content');\n"
+		<< "            textarea.select();\n"
+		<< "            document.execCommand('copy');\n"
+		<< "            alert('Text copied to clipboard!');\n"
+		<< "        }\n"
+		<< "        function downloadText() {\n"
+		<< "            const textarea = document.getElementById('content');\n"
+		<< "            const text = textarea.value;\n"
+		<< "            const element = document.createElement('a');\n"
+		<< "            element.setAttribute('href', 'data:text/plain;charset=utf-8,' + encodeURIComponent(text));\n"
+		<< "            element.setAttribute('download', 'ocr_result.txt');\n"
+		<< "            element.style.display = 'none';\n"
+		<< "            document.body.appendChild(element);\n"
+		<< "            element.click();\n"
+		<< "            document.body.removeChild(element);\n"
+		<< "        }\n"
+		<< "    </script>\n"
+		<< "</body>\n"
+		<< "</html>\n";
+	file.close();
+	return htmlPath;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <QString>
+
+// Writes the text into a standalone page in the temp directory, for reading
+// in a browser with dictionary extensions such as Yomitan. Returns the path,
+// or an empty string if the file could not be written.
+QString writeResultHtml(const QString& text);
@@ -0,0 +1,252 @@
+#include "kernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define OCR_KERNELS_X86 1
+#endif
+
+namespace Kernels {
+
+	namespace {
+
+		// qGray(): (11 * r + 16 * g + 5 * b) / 32, with b first in memory
+		constexpr uint8_t kWeightB = 5;
+		constexpr uint8_t kWeightG = 16;
+		constexpr uint8_t kWeightR = 11;
+
+		void grayscaleScalar(const uint8_t* bgra, uint8_t* gray, size_t pixels) {
+			for (size_t i = 0; i < pixels; ++i) {
+				const uint8_t* p = bgra + i * 4;
+				gray[i] = static_cast<uint8_t>((p[0] * kWeightB + p[1] * kWeightG + p[2] * kWeightR) >> 5);
+			}
+		}
+
+		void thresholdScalar(uint8_t* data, size_t size, uint8_t threshold) {
+			for (size_t i = 0; i < size; ++i) {
+				data[i] = data[i] >= threshold ? 255 : 0;
+			}
+		}
+
+		uint64_t sumScalar(const uint8_t* data, size_t size) {
+			uint64_t sum = 0;
+			for (size_t i = 0; i < size; ++i) {
+				sum += data[i];
+			}
+			return sum;
+		}
+
+#ifdef OCR_KERNELS_X86
+
+		// The vector versions handle whole registers and leave the tail to
+		// the scalar ones. maddubs() multiplies the unsigned pixel bytes by
+		// the signed weights and adds pairs, madd() with ones adds the pairs
+		// up to one 32-bit sum per pixel.
+
+		__attribute__((target("sse4.2")))
+		void grayscaleSse42(const uint8_t* bgra, uint8_t* gray, size_t pixels) {
+			const __m128i weights = _mm_setr_epi8(kWeightB, kWeightG, kWeightR, 0, kWeightB, kWeightG, kWeightR, 0,
+				kWeightB, kWeightG, kWeightR, 0, kWeightB, kWeightG, kWeightR, 0);
+			const __m128i ones = _mm_set1_epi16(1);
+			size_t i = 0;
+			for (; i + 8 <= pixels; i += 8) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + i * 4));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + i * 4 + 16));
+				a = _mm_srli_epi32(_mm_madd_epi16(_mm_maddubs_epi16(a, weights), ones), 5);
+				b = _mm_srli_epi32(_mm_madd_epi16(_mm_maddubs_epi16(b, weights), ones), 5);
+				const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_setzero_si128());
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(gray + i), bytes);
+			}
+			grayscaleScalar(bgra + i * 4, gray + i, pixels - i);
+		}
+
+		__attribute__((target("sse4.2")))
+		void thresholdSse42(uint8_t* data, size_t size, uint8_t threshold) {
+			const __m128i t = _mm_set1_epi8(static_cast<char>(threshold));
+			size_t i = 0;
+			for (; i + 16 <= size; i += 16) {
+				__m128i* p = reinterpret_cast<__m128i*>(data + i);
+				const __m128i v = _mm_loadu_si128(p);
+				// max(v, t) == v exactly when v >= t, unsigned
+				_mm_storeu_si128(p, _mm_cmpeq_epi8(_mm_max_epu8(v, t), v));
+			}
+			thresholdScalar(data + i, size - i, threshold);
+		}
+
+		__attribute__((target("sse4.2")))
+		uint64_t sumSse42(const uint8_t* data, size_t size) {
+			__m128i total = _mm_setzero_si128();
+			size_t i = 0;
+			for (; i + 16 <= size; i += 16) {
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+				total = _mm_add_epi64(total, _mm_sad_epu8(v, _mm_setzero_si128()));
+			}
+			return static_cast<uint64_t>(_mm_cvtsi128_si64(total)) + static_cast<uint64_t>(_mm_extract_epi64(total, 1))
+				+ sumScalar(data + i, size - i);
+		}
+
+		__attribute__((target("avx2")))
+		void grayscaleAvx2(const uint8_t* bgra, uint8_t* gray, size_t pixels) {
+			const __m256i weights = _mm256_set1_epi32(kWeightB | kWeightG << 8 | kWeightR << 16);
+			const __m256i ones = _mm256_set1_epi16(1);
+			size_t i = 0;
+			for (; i + 16 <= pixels; i += 16) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgra + i * 4));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgra + i * 4 + 32));
+				a = _mm256_srli_epi32(_mm256_madd_epi16(_mm256_maddubs_epi16(a, weights), ones), 5);
+				b = _mm256_srli_epi32(_mm256_madd_epi16(_mm256_maddubs_epi16(b, weights), ones), 5);
+				// Packing works per 128-bit lane, so the quarters are put back
+				// in order after each step
+				const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+				const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(gray + i), _mm256_castsi256_si128(bytes));
+			}
+			grayscaleSse42(bgra + i * 4, gray + i, pixels - i);
+		}
+
+		__attribute__((target("avx2")))
+		void thresholdAvx2(uint8_t* data, size_t size, uint8_t threshold) {
+			const __m256i t = _mm256_set1_epi8(static_cast<char>(threshold));
+			size_t i = 0;
+			for (; i + 32 <= size; i += 32) {
+				__m256i* p = reinterpret_cast<__m256i*>(data + i);
+				const __m256i v = _mm256_loadu_si256(p);
+				_mm256_storeu_si256(p, _mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v));
+			}
+			thresholdSse42(data + i, size - i, threshold);
+		}
+
+		__attribute__((target("avx2")))
+		uint64_t sumAvx2(const uint8_t* data, size_t size) {
+			__m256i total = _mm256_setzero_si256();
+			size_t i = 0;
+			for (; i + 32 <= size; i += 32) {
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+				total = _mm256_add_epi64(total, _mm256_sad_epu8(v, _mm256_setzero_si256()));
+			}
+			const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+			return static_cast<uint64_t>(_mm_cvtsi128_si64(half)) + static_cast<uint64_t>(_mm_extract_epi64(half, 1))
+				+ sumSse42(data + i, size - i);
+		}
+
+		__attribute__((target("avx512f,avx512bw")))
+		void grayscaleAvx512(const uint8_t* bgra, uint8_t* gray, size_t pixels) {
+			const __m512i weights = _mm512_set1_epi32(kWeightB | kWeightG << 8 | kWeightR << 16);
+			const __m512i ones = _mm512_set1_epi16(1);
+			size_t i = 0;
+			for (; i + 16 <= pixels; i += 16) {
+				const __m512i v = _mm512_loadu_si512(bgra + i * 4);
+				const __m512i sums = _mm512_srli_epi32(_mm512_madd_epi16(_mm512_maddubs_epi16(v, weights), ones), 5);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(gray + i), _mm512_cvtepi32_epi8(sums));
+			}
+			grayscaleAvx2(bgra + i * 4, gray + i, pixels - i);
+		}
+
+		__attribute__((target("avx512f,avx512bw")))
+		void thresholdAvx512(uint8_t* data, size_t size, uint8_t threshold) {
+			const __m512i t = _mm512_set1_epi8(static_cast<char>(threshold));
+			size_t i = 0;
+			for (; i + 64 <= size; i += 64) {
+				const __m512i v = _mm512_loadu_si512(data + i);
+				_mm512_storeu_si512(data + i, _mm512_movm_epi8(_mm512_cmpge_epu8_mask(v, t)));
+			}
+			thresholdAvx2(data + i, size - i, threshold);
+		}
+
+		__attribute__((target("avx512f,avx512bw")))
+		uint64_t sumAvx512(const uint8_t* data, size_t size) {
+			__m512i total = _mm512_setzero_si512();
+			size_t i = 0;
+			for (; i + 64 <= size; i += 64) {
+				const __m512i v = _mm512_loadu_si512(data + i);
+				total = _mm512_add_epi64(total, _mm512_sad_epu8(v, _mm512_setzero_si512()));
+			}
+			return static_cast<uint64_t>(_mm512_reduce_add_epi64(total)) + sumAvx2(data + i, size - i);
+		}
+
+#endif
+
+		Backend capped(Backend best) {
+			const char* requested = std::getenv("OCR_KERNELS");
+			if (!requested) {
+				return best;
+			}
+			for (Backend candidate : { Backend::Scalar, Backend::Sse42, Backend::Avx2, Backend::Avx512 }) {
+				if (std::strcmp(requested, backendName(candidate)) == 0) {
+					return candidate < best ? candidate : best;
+				}
+			}
+			return best;
+		}
+
+		struct Selection {
+			Backend backend;
+			Table table;
+		};
+
+		const Selection& selection() {
+			static const Selection selected = [] {
+				Selection s{ capped(cpuBackend()), { grayscaleScalar, thresholdScalar, sumScalar } };
+#ifdef OCR_KERNELS_X86
+				switch (s.backend) {
+				case Backend::Avx512:
+					s.table = { grayscaleAvx512, thresholdAvx512, sumAvx512 };
+					break;
+				case Backend::Avx2:
+					s.table = { grayscaleAvx2, thresholdAvx2, sumAvx2 };
+					break;
+				case Backend::Sse42:
+					s.table = { grayscaleSse42, thresholdSse42, sumSse42 };
+					break;
+				case Backend::Scalar:
+					break;
+				}
+#endif
+				return s;
+			}();
+			return selected;
+		}
+
+	}
+
+	const Table& table() {
+		return selection().table;
+	}
+
+	Backend backend() {
+		return selection().backend;
+	}
+
+	const char* backendName(Backend backend) {
+		switch (backend) {
+		case Backend::Sse42:
+			return "sse4.2";
+		case Backend::Avx2:
+			return "avx2";
+		case Backend::Avx512:
+			return "avx512";
+		case Backend::Scalar:
+			break;
+		}
+		return "scalar";
+	}
+
+	Backend cpuBackend() {
+#ifdef OCR_KERNELS_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+			return Backend::Avx512;
+		}
+		if (__builtin_cpu_supports("avx2")) {
+			return Backend::Avx2;
+		}
+		if (__builtin_cpu_supports("sse4.2")) {
+			return Backend::Sse42;
+		}
+#endif
+		return Backend::Scalar;
+	}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel loops of the preprocessing, with scalar, SSE4.2, AVX2 and AVX-512
+// versions. The best one the CPU supports is picked on first use;
+// OCR_KERNELS=scalar|sse4.2|avx2|avx512 caps the choice, for comparing
+// backends or working around a broken one.
+namespace Kernels {
+
+	enum class Backend { Scalar, Sse42, Avx2, Avx512 };
+
+	struct Table {
+		// 32-bit BGRA/BGRX pixels (Qt's RGB32 and ARGB32 on little endian)
+		// to 8-bit luminance with qGray()'s weights
+		void (*grayscale)(const uint8_t* bgra, uint8_t* gray, size_t pixels);
+		// In place: 255 where value >= threshold, 0 elsewhere
+		void (*threshold)(uint8_t* data, size_t size, uint8_t threshold);
+		uint64_t (*sum)(const uint8_t* data, size_t size);
+	};
+
+	const Table& table();
+	Backend backend();
+	const char* backendName(Backend backend);
+
+	// The best backend this CPU supports, regardless of OCR_KERNELS
+	Backend cpuBackend();
+
+}
@@ -1,6 +1,3 @@
-#include <leptonica/allheaders.h>
-#include <tesseract/baseapi.h>
-#include <ZXing/ReadBarcode.h>
 // qt imports
 #include <QCommandLineParser>
 #include <QDir>
@@ -9,6 +6,7 @@
 #include <QTimer>
 #include <QClipboard>
 #include <QApplication>
+#include <QGuiApplication>
 #include <QFileDialog>
 #include <QLabel>
 #include <QMessageBox>
@@ -19,101 +17,219 @@
 #include <QHBoxLayout>
 #include <QDateTime>
 #include <QImage>
+#include <QImageReader>
+#include <QCursor>
+#include <QScreen>
+#include <QPointer>
+#include <QJsonDocument>
 #include <QDesktopServices>
 #include <QUrl>
+#include <future>
+#include <map>
 #include <memory>
-
-bool takeScreenshot(const QString& outputPath) {
-	int exitCode = QProcess::execute("spectacle", QStringList()
-		<< "-b" << "-r" << "-n" << "-o" << outputPath);
-	return exitCode == 0;
-}
-
-struct OcrResult {
-	QString text;
-	bool success;
-	QString errorMessage;
-	bool isQrCode = false;
-};
-
-OcrResult detectQrCode(const QString& imagePath) {
-	OcrResult result;
-	result.success = false;
-
-	QImage image(imagePath);
-	if (image.isNull()) {
-		result.errorMessage = "Failed to load image for QR detection";
-		return result;
+#include <optional>
+#include <vector>
+#include "ocr.h"
+#include "flightrecorder.h"
+#include "htmlresult.h"
+#include "memstats.h"
+#include "refinement.h"
+#include "routing.h"
+#include "scripts.h"
+#include "server.h"
+#include "startup.h"
+#include "stripes.h"
+#include "trace.h"
+
+namespace {
+
+	enum class AppMode { Window, Headless, Console };
+
+	// Decided before the parser exists, since it needs the application.
+	// Modes that never show a window skip the widget style, palette and
+	// font setup of QApplication.
+	AppMode appModeFor(int argc, char* argv[]) {
+		AppMode mode = AppMode::Window;
+		for (int i = 1; i < argc; ++i) {
+			if (qstrcmp(argv[i], "--dump-flight-recorder") == 0) {
+				return AppMode::Console;
+			}
+			if (qstrcmp(argv[i], "--web") == 0 || qstrcmp(argv[i], "--browser") == 0 || qstrcmp(argv[i], "--copy") == 0) {
+				mode = AppMode::Headless;
+			}
+		}
+		return mode;
 	}
 
-	// Convert image to RGB32 to ensure consistent format
-	if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32) {
-		image = image.convertToFormat(QImage::Format_RGB32);
+	QString statusText(const OcrResult& result, bool refining) {
+		if (result.isQrCode) {
+			return "QR code detected and decoded successfully";
+		}
+		if (!result.word.isEmpty()) {
+			return "Nearest to the pointer: " + result.word + " (reading the rest of the capture)";
+		}
+		if (refining) {
+			return "Text extracted successfully (" + result.configuration + " pass).";
+		}
+		return "Text extracted successfully.";
 	}
 
-	ZXing::ReaderOptions options;
-	options.setFormats(ZXing::BarcodeFormat::QRCode);
-	options.setTryHarder(true);
-	options.setTryRotate(true);  // Try rotated images
-
-	const uchar* data = image.constBits();
-	int width = image.width();
-	int height = image.height();
-	int bytesPerLine = image.bytesPerLine();
-
-	// Use ARGB format for RGB32 and ARGB32
-	ZXing::ImageFormat format = ZXing::ImageFormat::ARGB;
+	// The capture of the monitor under the pointer (spectacle -m) starts at
+	// that monitor's top left corner, in device pixels
+	std::optional<QPoint> pointerOnCurrentMonitor() {
+		// Wayland only tells clients where the pointer is over their own windows
+		if (QGuiApplication::platformName().startsWith("wayland")) {
+			return std::nullopt;
+		}
+		const QPoint cursor = QCursor::pos();
+		const QScreen* screen = QGuiApplication::screenAt(cursor);
+		if (!screen) {
+			return std::nullopt;
+		}
+		return (cursor - screen->geometry().topLeft()) * screen->devicePixelRatio();
+	}
 
-	ZXing::ImageView imageView(data, width, height, format, bytesPerLine);
-	auto zxingResult = ZXing::ReadBarcode(imageView, options);
+	// WM_CLASS of the focused window on X11. Wayland does not tell clients
+	// about other windows.
+	QString activeWindowClass() {
+		QProcess xprop;
+		xprop.start("xprop", QStringList() << "-root" << "_NET_ACTIVE_WINDOW");
+		if (!xprop.waitForFinished(500)) {
+			return QString();
+		}
+		// _NET_ACTIVE_WINDOW(WINDOW): window id # 0x3a00007
+		const QString id = QString::fromLatin1(xprop.readAllStandardOutput()).section('#', 1).section(',', 0, 0).trimmed();
+		if (id.isEmpty() || id == "0x0") {
+			return QString();
+		}
+		xprop.start("xprop", QStringList() << "-id" << id << "WM_CLASS");
+		if (!xprop.waitForFinished(500)) {
+			return QString();
+		}
+		// WM_CLASS(STRING) = "Navigator", "firefox"
+		const QString names = QString::fromLatin1(xprop.readAllStandardOutput()).section('=', 1);
+		return names.section(',', -1).trimmed().remove('"');
+	}
 
-	if (zxingResult.isValid()) {
-		result.text = QString::fromStdString(zxingResult.text());
-		result.success = true;
-		result.isQrCode = true;
+	// X11 and Wayland fetch the clipboard from the program that set it, so
+	// text set by --copy would be gone once the process exits. wl-copy and
+	// xclip fork a process that keeps serving it until something else is
+	// copied.
+	constexpr int kClipboardToolMs = 2000;
+	// Without them the text is served from here until a clipboard manager
+	// such as Klipper, or another program, takes the clipboard over
+	constexpr int kServeClipboardMs = 60000;
+
+	bool copyWithTool(const QString& text) {
+		QStringList arguments;
+		if (!qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+			arguments << "wl-copy";
+		}
+		else if (!qEnvironmentVariableIsEmpty("DISPLAY")) {
+			arguments << "xclip" << "-selection" << "clipboard";
+		}
+		else {
+			return false;
+		}
+		QProcess tool;
+		tool.start(arguments.takeFirst(), arguments);
+		if (!tool.waitForStarted(kClipboardToolMs)) {
+			return false;
+		}
+		tool.write(text.toUtf8());
+		tool.closeWriteChannel();
+		return tool.waitForFinished(kClipboardToolMs) && tool.exitStatus() == QProcess::NormalExit
+			&& tool.exitCode() == 0;
 	}
-	else {
-		result.errorMessage = "Failed to detect valid QR code";
+
+	// Runs the event loop while this process still owns the clipboard
+	void serveClipboard() {
+		QClipboard* clipboard = QGuiApplication::clipboard();
+		QObject::connect(clipboard, &QClipboard::dataChanged, [clipboard]() {
+			if (!clipboard->ownsClipboard()) {
+				QCoreApplication::quit();
+			}
+			});
+		QTimer::singleShot(kServeClipboardMs, []() { QCoreApplication::quit(); });
+		QCoreApplication::exec();
 	}
 
-	return result;
-}
+	// Engines initialized on threads while the capture runs, each taken at
+	// most once
+	class EnginePreload {
+	public:
+		explicit EnginePreload(const OcrOptions& options) : m_options(options) {}
 
-OcrResult extractText(const QString& imagePath, const QString& language) {
-	OcrResult result;
-	result.success = true;
+		void start(const QString& language) {
+			m_engines[language] = std::async(std::launch::async, [language, options = m_options]() {
+				return std::make_unique<OcrEngine>(language, options);
+				});
+		}
 
-	auto ocr = std::make_unique<tesseract::TessBaseAPI>();
+		// The preloaded engine for language, or a new one
+		std::unique_ptr<OcrEngine> take(const QString& language) {
+			auto preloaded = m_engines.find(language);
+			if (preloaded != m_engines.end() && preloaded->second.valid()) {
+				return preloaded->second.get();
+			}
+			return std::make_unique<OcrEngine>(language, m_options);
+		}
 
-	if (ocr->Init(nullptr, language.toUtf8().constData())) {
-		result.success = false;
-		result.errorMessage =
-			"Error initializing Tesseract OCR for language: " + language;
-		return result;
-	}
+	private:
+		OcrOptions m_options;
+		std::map<QString, std::future<std::unique_ptr<OcrEngine>>> m_engines;
+	};
+
+	// Languages still mixed after script detection are not combined into one
+	// engine, and vertical text goes to a vertical model; each text block
+	// goes to the engine of its own language. Without a detector (a single
+	// language), only the latter.
+	OcrResult recognizeRouted(EnginePreload& engines, std::unique_ptr<Scripts::Detector> detector,
+		const QString& imagePath, const QString& language, const QString& windowClass) {
+		const QString languages = detector ? Scripts::languagesFor(*detector, imagePath, language, windowClass) : language;
+		const bool routed = languages.contains('+') ? detector && detector->isValid() : Routing::isWorthwhile(languages);
+		if (!routed) {
+			return engines.take(languages)->recognize(imagePath);
+		}
 
-	Pix* image = pixRead(imagePath.toUtf8().constData());
-	if (!image) {
-		ocr->End();
-		result.success = false;
-		result.errorMessage = "Failed to load image";
-		return result;
+		std::map<QString, std::unique_ptr<OcrEngine>> byLanguage;
+		return Routing::recognizeFile(imagePath, languages, detector.get(), [&engines, &byLanguage](const QString& part) {
+			std::unique_ptr<OcrEngine>& engine = byLanguage[part];
+			if (!engine) {
+				engine = engines.take(part);
+			}
+			return engine.get();
+			});
 	}
 
-	ocr->SetImage(image);
-
-	char* outText = ocr->GetUTF8Text();
-	result.text = QString::fromUtf8(outText);
-
-	delete[] outText;
-	pixDestroy(&image);
-	ocr->End();
+	QCoreApplication* createApplication(AppMode mode, int& argc, char* argv[]) {
+		switch (mode) {
+		case AppMode::Console:
+			return new QCoreApplication(argc, argv);
+		case AppMode::Headless:
+			return new QGuiApplication(argc, argv);
+		case AppMode::Window:
+			break;
+		}
+		return new QApplication(argc, argv);
+	}
 
-	return result;
 }
 
 int main(int argc, char* argv[]) {
-	QApplication app(argc, argv);
+	// The service has no window, so it is dispatched before QApplication
+	for (int i = 1; i < argc; ++i) {
+		if (qstrcmp(argv[i], "--server") == 0) {
+			return Server::run(argc, argv);
+		}
+	}
+
+	Startup::mark("main");
+	const AppMode mode = appModeFor(argc, argv);
+	const int64_t appInitStart = Trace::now();
+	std::unique_ptr<QCoreApplication> app(createApplication(mode, argc, argv));
+	const int64_t appInitEnd = Trace::now();
+	Startup::mark("qapplication");
 
 	QCommandLineParser parser;
 	parser.setApplicationDescription("Extract text from spectacle screenshots using OCR");
@@ -132,16 +248,313 @@ int main(int argc, char* argv[]) {
 		QStringList() << "web" << "browser",
 		"Open OCR results in web browser.");
 
+	QCommandLineOption copyOption(
+		QStringList() << "copy",
+		"Copy the text to the clipboard and exit without showing a window.");
+
+	QCommandLineOption traceOption(
+		QStringList() << "trace",
+		"Write a Chrome/Perfetto trace of every pipeline stage to <file>.",
+		"file");
+
+	QCommandLineOption memReportOption(
+		QStringList() << "mem-report",
+		"Print RSS, heap and allocation counts for every pipeline stage on exit.");
+
+	QCommandLineOption startupReportOption(
+		QStringList() << "startup-report",
+		"Print the time from process start to window and text on screen.");
+
+	QCommandLineOption startupJsonOption(
+		QStringList() << "startup-json",
+		"Append the startup milestones as a JSON line to <file>.",
+		"file");
+
+	QCommandLineOption imageOption(
+		QStringList() << "image",
+		"Run on <file> instead of taking a screenshot.",
+		"file");
+
+	QCommandLineOption profileOption(
+		QStringList() << "profile",
+		"Load engine settings written by ocr-bench --autotune from <file> (default: "
+		+ defaultOcrProfilePath() + " if it exists).",
+		"file");
+
+	QCommandLineOption dumpFlightRecorderOption(
+		QStringList() << "dump-flight-recorder",
+		"Print the stage timings of the last captures, from every instance, as JSON and exit.");
+
+	QCommandLineOption serverOption(
+		QStringList() << "server",
+		"Run as a resident OCR service that other instances hand their captures to (see --server --help).");
+
+	QCommandLineOption noServerOption(
+		QStringList() << "no-server",
+		"Do the OCR in this process even if a --server instance is running.");
+
+	QCommandLineOption deadlineOption(
+		QStringList() << "deadline",
+		"Show the best text available <ms> after the capture, starting with a quick pass, and "
+		"replace it as better passes finish.",
+		"ms");
+
+	QCommandLineOption nearPointerOption(
+		QStringList() << "near-pointer",
+		"Capture the monitor under the pointer and show the line of text nearest to the pointer first; "
+		"the rest of the capture follows. With --copy, copy only the word nearest to the pointer.");
+
+	QCommandLineOption pointerAtOption(
+		QStringList() << "pointer-at",
+		"Pointer position <x,y> in image pixels for --near-pointer, e.g. with --image.",
+		"x,y");
+
+	QCommandLineOption noScriptDetectionOption(
+		QStringList() << "no-script-detection",
+		"Recognize with every --lang language, not only those whose script appears in the capture.");
+
+	QCommandLineOption windowClassOption(
+		QStringList() << "window-class",
+		"Window class to cache detected scripts under (default: the active window's on X11).",
+		"name");
+
+	QCommandLineOption quitAfterTextOption(
+		QStringList() << "quit-after-text",
+		"Quit as soon as the text is on screen (for startup benchmarks).");
+
 	parser.addOption(langOption);
 	parser.addOption(disable_qr);
 	parser.addOption(webBrowserOption);
-	parser.process(app);
+	parser.addOption(copyOption);
+	parser.addOption(traceOption);
+	parser.addOption(memReportOption);
+	parser.addOption(startupReportOption);
+	parser.addOption(startupJsonOption);
+	parser.addOption(imageOption);
+	parser.addOption(profileOption);
+	parser.addOption(deadlineOption);
+	parser.addOption(nearPointerOption);
+	parser.addOption(pointerAtOption);
+	parser.addOption(noScriptDetectionOption);
+	parser.addOption(windowClassOption);
+	parser.addOption(quitAfterTextOption);
+	parser.addOption(dumpFlightRecorderOption);
+	parser.addOption(serverOption);
+	parser.addOption(noServerOption);
+	parser.process(*app);
+
+	if (parser.isSet(dumpFlightRecorderOption)) {
+		QTextStream(stdout) << QJsonDocument(FlightRecorder::dump()).toJson(QJsonDocument::Indented);
+		return 0;
+	}
+
+	Startup::Session startupSession(parser.isSet(startupReportOption), parser.value(startupJsonOption));
+	MemStats::Session memSession(parser.isSet(memReportOption));
+	Trace::Session traceSession(parser.value(traceOption));
+	Trace::record("qt.application_init", "startup", appInitStart, appInitEnd);
+	FlightRecorder::open();
+	FlightRecorder::installDumpSignal();
 
 	QString language = parser.value(langOption);
 
-	// Check if web browser output is requested
-	bool openInBrowser = parser.isSet(webBrowserOption);
+	const QString profilePath = parser.isSet(profileOption) ? parser.value(profileOption) : defaultOcrProfilePath();
+	if (parser.isSet(profileOption) && !QFile::exists(profilePath)) {
+		QTextStream(stderr) << "No such profile: " << profilePath << ", using default settings\n";
+	}
+	const OcrOptions ocrOptions = loadOcrProfile(profilePath);
+
+	QString tempPath = parser.isSet(imageOption) ? parser.value(imageOption) : QDir::tempPath() + "/screenshot.png";
+
+	// --near-pointer needs to know where the pointer was when the capture
+	// was taken, in image pixels
+	const bool nearPointer = parser.isSet(nearPointerOption) || parser.isSet(pointerAtOption);
+	std::optional<QPoint> pointer;
+	if (parser.isSet(pointerAtOption)) {
+		const QStringList xy = parser.value(pointerAtOption).split(',');
+		bool xOk = false;
+		bool yOk = false;
+		if (xy.size() == 2) {
+			const QPoint point(xy[0].toInt(&xOk), xy[1].toInt(&yOk));
+			if (xOk && yOk) {
+				pointer = point;
+			}
+		}
+		if (!pointer) {
+			QTextStream(stderr) << "Invalid --pointer-at, expected x,y: " << parser.value(pointerAtOption) << "\n";
+		}
+	}
+	else if (nearPointer && !parser.isSet(imageOption)) {
+		pointer = pointerOnCurrentMonitor();
+		if (!pointer) {
+			QTextStream(stderr) << "Pointer position unknown, recognizing the whole capture\n";
+		}
+	}
+
+	// With several languages, only those whose script is in the capture
+	// are recognized with; the window the capture came from remembers them
+	const bool detectScripts = language.contains('+') && !parser.isSet(noScriptDetectionOption);
+	// Text blocks go to single-language engines, vertical ones to vertical
+	// models where installed
+	const bool routeBlocks = detectScripts || (!language.contains('+') && Routing::isWorthwhile(language));
+	std::future<QString> activeWindow;
+	if (detectScripts && !parser.isSet(windowClassOption) && !parser.isSet(imageOption)) {
+		activeWindow = std::async(std::launch::async, activeWindowClass);
+	}
+
+	// Loading the QR plugin and initializing the engines overlap with the
+	// capture, which mostly waits for the user to select a region. Which of
+	// several languages are needed is only known afterwards, so each gets
+	// an engine of its own. A running --server does all of it itself, but
+	// has no pointer pass.
+	const bool serverRunning = !parser.isSet(noServerOption) && !pointer && QFile::exists(Server::socketPath());
+	std::future<void> qrPreload;
+	auto engines = std::make_shared<EnginePreload>(ocrOptions);
+	auto detector = std::make_shared<std::future<std::unique_ptr<Scripts::Detector>>>();
+	if (!serverRunning) {
+		if (!parser.isSet(disable_qr)) {
+			qrPreload = std::async(std::launch::async, preloadQrPlugin);
+		}
+		if (detectScripts) {
+			for (const QString& part : language.split('+', Qt::SkipEmptyParts)) {
+				engines->start(part);
+			}
+			*detector = std::async(std::launch::async, []() {
+				return std::make_unique<Scripts::Detector>();
+				});
+		}
+		// Refinement keeps whatever languages detection leaves on one engine
+		if (!detectScripts || parser.isSet(deadlineOption) || pointer) {
+			engines->start(language);
+		}
+		if (routeBlocks) {
+			for (const QString& part : language.split('+', Qt::SkipEmptyParts)) {
+				const QString vertical = Routing::verticalLanguage(part);
+				if (!vertical.isEmpty()) {
+					engines->start(vertical);
+				}
+			}
+		}
+	}
+
+	FlightRecorder::Capture capture(language);
+	const bool captured = parser.isSet(imageOption) ? QFile::exists(tempPath)
+		: takeScreenshot(tempPath, nearPointer ? CaptureArea::CurrentMonitor : CaptureArea::Region);
+	Startup::mark("capture_done");
+
+	const QString windowClass = parser.isSet(windowClassOption) ? parser.value(windowClassOption)
+		: activeWindow.valid() ? activeWindow.get() : QString();
+
+	OcrResult result;
+	std::unique_ptr<Refinement> refinement;
+	if (captured) {
+		const QSize imageSize = QImageReader(tempPath).size();
+		capture.setImageSize(imageSize.width(), imageSize.height());
+
+		// Scripts are detected on whichever thread first needs the languages
+		// of the whole capture, after QR detection and the quick passes had
+		// their chance. Those take the preloaded engine of the first language
+		// the window showed lately, or of the first language.
+		const Refinement::LanguageSelector selectLanguages = [detector, language, tempPath, windowClass,
+			detectScripts](bool quick) {
+			if (!detectScripts) {
+				return language;
+			}
+			if (quick) {
+				const std::optional<QStringList> seen = Scripts::cached(windowClass);
+				return (seen ? Scripts::select(language, *seen) : language).section('+', 0, 0);
+			}
+			std::unique_ptr<Scripts::Detector> osd = detector->valid()
+				? detector->get() : std::make_unique<Scripts::Detector>();
+			return Scripts::languagesFor(*osd, tempPath, language, windowClass);
+		};
+		const Refinement::EngineFactory makeEngine = [engines](const QString& languages) {
+			return engines->take(languages);
+		};
+
+		// A running --server has warm engines and does both steps itself,
+		// but knows neither deadlines nor the pointer
+		const bool served = !parser.isSet(noServerOption) && !pointer && !parser.isSet(deadlineOption)
+			&& Server::recognize(tempPath, language, !parser.isSet(disable_qr), result, detectScripts, windowClass);
+		if (!served && (parser.isSet(deadlineOption) || pointer)) {
+			std::vector<Refinement::Pass> passes = Refinement::passesFor(imageSize, ocrOptions,
+				!parser.isSet(disable_qr), parser.isSet(deadlineOption));
+			if (pointer) {
+				passes.insert(passes.begin(), Refinement::pointerPass(*pointer, ocrOptions));
+			}
+			refinement = std::make_unique<Refinement>(makeEngine, selectLanguages, tempPath, std::move(passes));
+			// Without a deadline the line under the pointer is shown as soon
+			// as it is there
+			const int deadline = parser.isSet(deadlineOption) ? qMax(0, parser.value(deadlineOption).toInt()) : -1;
+			result = refinement->waitForBest(deadline);
+		}
+		else if (!served) {
+			if (!parser.isSet(disable_qr)) {
+				TRACE_SCOPE("qr");
+				result = detectQrCode(tempPath);
+			}
+			if (!result.success) {
+				TRACE_SCOPE("ocr");
+				// Large captures go through the stripe path on one engine
+				if (routeBlocks && !Stripes::isLarge(imageSize)) {
+					std::unique_ptr<Scripts::Detector> osd;
+					if (detectScripts) {
+						osd = detector->valid() ? detector->get() : std::make_unique<Scripts::Detector>();
+					}
+					result = recognizeRouted(*engines, std::move(osd), tempPath, language, windowClass);
+				}
+				else {
+					result = makeEngine(selectLanguages(false))->recognize(tempPath);
+				}
+				result.configuration = "full";
+			}
+		}
+		Startup::mark("result_ready");
+		capture.setResult(result);
+	}
 
+	// --web and --copy hand the result on and exit; no widget is created
+	if (mode == AppMode::Headless) {
+		if (refinement) {
+			// Nobody is left to show a better result to
+			refinement->cancel();
+		}
+		capture.commit();
+		QTextStream err(stderr);
+		if (!captured) {
+			err << "Failed to launch Spectacle or take screenshot\n";
+			return 1;
+		}
+		if (!result.success) {
+			err << result.errorMessage << "\n";
+			return 1;
+		}
+
+		bool ownsClipboard = false;
+		if (parser.isSet(copyOption)) {
+			TRACE_SCOPE("clipboard.copy");
+			const QString text = result.word.isEmpty() ? result.text : result.word;
+			if (!copyWithTool(text)) {
+				QGuiApplication::clipboard()->setText(text);
+				ownsClipboard = true;
+			}
+		}
+		if (parser.isSet(webBrowserOption)) {
+			const QString htmlPath = writeResultHtml(result.text);
+			if (htmlPath.isEmpty()) {
+				err << "Failed to create temporary HTML file\n";
+				return 1;
+			}
+			TRACE_SCOPE("browser.open");
+			QDesktopServices::openUrl(QUrl::fromLocalFile(htmlPath));
+			Startup::mark("browser_opened");
+		}
+		if (ownsClipboard) {
+			serveClipboard();
+		}
+		return 0;
+	}
+
+	Trace::Span uiSpan("ui.build");
 	QWidget window;
 	window.setWindowTitle("Spectacle Screenshot OCR - Language: " + language);
 	window.resize(500, 400);
@@ -170,8 +583,8 @@ int main(int argc, char* argv[]) {
 	layout->addWidget(buttonContainer);
 
 	window.setLayout(layout);
-
-	QString tempPath = QDir::tempPath() + "/screenshot.png";
+	uiSpan.end();
+	Startup::mark("window_built");
 
 	QObject::connect(copyButton, &QPushButton::clicked, [&]() {
 		if (!textEdit->toPlainText().isEmpty()) {
@@ -227,105 +640,13 @@ int main(int argc, char* argv[]) {
 	QObject::connect(browserButton, &QPushButton::clicked, [&]() {
 		if (!textEdit->toPlainText().isEmpty()) {
 			// Create a temporary HTML file with the OCR results
-			QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
-			QString htmlPath = QDir::tempPath() + "/ocr_result_" + timestamp + ".html";
-			
-			QFile file(htmlPath);
-			if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-				QTextStream out(&file);
-				out << "<!DOCTYPE html>\n"
-					<< "<html lang=\"en\">\n"
-					<< "<head>\n"
-					<< "    <meta charset=\"UTF-8\">\n"
-					<< "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-					<< "    <title>OCR Results</title>\n"
-					<< "    <style>\n"
-					<< "        body {\n"
-					<< "            font-family: Arial, sans-serif;\n"
-					<< "            margin: 20px;\n"
-					<< "            line-height: 1.6;\n"
-					<< "            background-color: #f4f4f4;\n"
-					<< "        }\n"
-					<< "        .container {\n"
-					<< "            max-width: 800px;\n"
-					<< "            margin: 0 auto;\n"
-					<< "            background-color: white;\n"
-					<< "            padding: 20px;\n"
-					<< "            border-radius: 8px;\n"
-					<< "            box-shadow: 0 2px 4px rgba(0,0,0,0.1);\n"
-					<< "        }\n"
-					<< "        h1 {\n"
-					<< "            color: #333;\n"
-					<< "        }\n"
-					<< "        .timestamp {\n"
-					<< "            color: #666;\n"
-					<< "            font-size: 0.9em;\n"
-					<< "        }\n"
-					<< "        .content {\n"
-					<< "            width: 100%;\n"
-					<< "            min-height: 300px;\n"
-					<< "            padding: 15px;\n"
-					<< "            border: 2px solid #007bff;\n"
-					<< "            border-radius: 4px;\n"
-					<< "            font-family: 'Courier New', monospace;\n"
-					<< "            font-size: 14px;\n"
-					<< "            box-sizing: border-box;\n"
-					<< "            resize: vertical;\n"
-					<< "        }\n"
-					<< "        .button-group {\n"
-					<< "            margin-top: 15px;\n"
-					<< "            display: flex;\n"
-					<< "            gap: 10px;\n"
-					<< "        }\n"
-					<< "        button {\n"
-					<< "            padding: 10px 20px;\n"
-					<< "            background-color: #007bff;\n"
-					<< "            color: white;\n"
-					<< "            border: none;\n"
-					<< "            border-radius: 4px;\n"
-					<< "            cursor: pointer;\n"
-					<< "            font-size: 14px;\n"
-					<< "        }\n"
-					<< "        button:hover {\n"
-					<< "            background-color: #0056b3;\n"
-					<< "        }\n"
-					<< "    </style>\n"
-					<< "</head>\n"
-					<< "<body>\n"
-					<< "    <div class=\"container\">\n"
-					<< "        <h1>OCR Results</h1>\n"
-					<< "        <p class=\"timestamp\">Generated: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << "</p>\n"
-					<< "        <textarea id=\"content\" class=\"content\">" << textEdit->toPlainText().toHtmlEscaped() << "</textarea>\n"
-					<< "        <div class=\"button-group\">\n"
-					<< "            <button onclick=\"copyText()\">Copy to Clipboard</button>\n"
-					<< "            <button onclick=\"downloadText()\">Download as TXT</button>\n"
-					<< "        </div>\n"
-					<< "    </div>\n"
-					<< "    <script>\n"
-					<< "        function copyText() {\n"
-					<< "            const textarea = document.getElementById('content');\n"
-					<< "            textarea.select();\n"
-					<< "            document.execCommand('copy');\n"
-					<< "            alert('Text copied to clipboard!');\n"
-					<< "        }\n"
-					<< "        function downloadText() {\n"
-					<< "            const textarea = document.getElementById('content');\n"
-					<< "            const text = textarea.value;\n"
-					<< "            const element = document.createElement('a');\n"
-					<< "            element.setAttribute('href', 'data:text/plain;charset=utf-8,' + encodeURIComponent(text));\n"
-					<< "            element.setAttribute('download', 'ocr_result.txt');\n"
-					<< "            element.style.display = 'none';\n"
-					<< "            document.body.appendChild(element);\n"
-					<< "            element.click();\n"
-					<< "            document.body.removeChild(element);\n"
-					<< "        }\n"
-					<< "    </script>\n"
-					<< "</body>\n"
-					<< "</html>\n";
-				file.close();
-				
+			const QString htmlPath = writeResultHtml(textEdit->toPlainText());
+			if (!htmlPath.isEmpty()) {
 				// Open the HTML file in the default web browser
-				if (QDesktopServices::openUrl(QUrl::fromLocalFile(htmlPath))) {
+				Trace::Span browserSpan("browser.open");
+				const bool opened = QDesktopServices::openUrl(QUrl::fromLocalFile(htmlPath));
+				browserSpan.end();
+				if (opened) {
 					label->setText("OCR results opened in web browser");
 				} else {
 					label->setText("Failed to open web browser");
@@ -341,237 +662,50 @@ int main(int argc, char* argv[]) {
 		}
 		});
 
-	if (takeScreenshot(tempPath)) {
-		OcrResult result;
-		if (!parser.isSet(disable_qr)) {
-			result = detectQrCode(tempPath);
-			if (result.success) {
+
+	if (captured) {
+		{
+			TRACE_SCOPE("ui.update");
+			if (!result.success) {
+				textEdit->setText("");
+				label->setText(result.errorMessage);
+			}
+			else {
 				textEdit->setText(result.text);
-				label->setText("QR code detected and decoded successfully");
-				
-				// Auto-open in browser if requested
-				if (openInBrowser) {
-					QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
-					QString htmlPath = QDir::tempPath() + "/ocr_result_" + timestamp + ".html";
-					
-					QFile file(htmlPath);
-					if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-						QTextStream out(&file);
-						out << "<!DOCTYPE html>\n"
-							<< "<html lang=\"en\">\n"
-							<< "<head>\n"
-							<< "    <meta charset=\"UTF-8\">\n"
-							<< "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-							<< "    <title>OCR Results</title>\n"
-							<< "    <style>\n"
-							<< "        body {\n"
-							<< "            font-family: Arial, sans-serif;\n"
-							<< "            margin: 20px;\n"
-							<< "            line-height: 1.6;\n"
-							<< "            background-color: #f4f4f4;\n"
-							<< "        }\n"
-							<< "        .container {\n"
-							<< "            max-width: 800px;\n"
-							<< "            margin: 0 auto;\n"
-							<< "            background-color: white;\n"
-							<< "            padding: 20px;\n"
-							<< "            border-radius: 8px;\n"
-							<< "            box-shadow: 0 2px 4px rgba(0,0,0,0.1);\n"
-							<< "        }\n"
-							<< "        h1 {\n"
-							<< "            color: #333;\n"
-							<< "        }\n"
-							<< "        .timestamp {\n"
-							<< "            color: #666;\n"
-							<< "            font-size: 0.9em;\n"
-							<< "        }\n"
-							<< "        .content {\n"
-							<< "            width: 100%;\n"
-							<< "            min-height: 300px;\n"
-							<< "            padding: 15px;\n"
-							<< "            border: 2px solid #007bff;\n"
-							<< "            border-radius: 4px;\n"
-							<< "            font-family: 'Courier New', monospace;\n"
-							<< "            font-size: 14px;\n"
-							<< "            box-sizing: border-box;\n"
-							<< "            resize: vertical;\n"
-							<< "        }\n"
-							<< "        .button-group {\n"
-							<< "            margin-top: 15px;\n"
-							<< "            display: flex;\n"
-							<< "            gap: 10px;\n"
-							<< "        }\n"
-							<< "        button {\n"
-							<< "            padding: 10px 20px;\n"
-							<< "            background-color: #007bff;\n"
-							<< "            color: white;\n"
-							<< "            border: none;\n"
-							<< "            border-radius: 4px;\n"
-							<< "            cursor: pointer;\n"
-							<< "            font-size: 14px;\n"
-							<< "        }\n"
-							<< "        button:hover {\n"
-							<< "            background-color: #0056b3;\n"
-							<< "        }\n"
-							<< "    </style>\n"
-							<< "</head>\n"
-							<< "<body>\n"
-							<< "    <div class=\"container\">\n"
-							<< "        <h1>OCR Results</h1>\n"
-							<< "        <p class=\"timestamp\">Generated: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << "</p>\n"
-							<< "        <textarea id=\"content\" class=\"content\">" << result.text.toHtmlEscaped() << "</textarea>\n"
-							<< "        <div class=\"button-group\">\n"
-							<< "            <button onclick=\"copyText()\">Copy to Clipboard</button>\n"
-							<< "            <button onclick=\"downloadText()\">Download as TXT</button>\n"
-							<< "        </div>\n"
-							<< "    </div>\n"
-							<< "    <script>\n"
-							<< "        function copyText() {\n"
-							<< "            const textarea = document.getElementById('content');\n"
-							<< "            textarea.select();\n"
-							<< "            document.execCommand('copy');\n"
-							<< "            alert('Text copied to clipboard!');\n"
-							<< "        }\n"
-							<< "        function downloadText() {\n"
-							<< "            const textarea = document.getElementById('content');\n"
-							<< "            const text = textarea.value;\n"
-							<< "            const element = document.createElement('a');\n"
-							<< "            element.setAttribute('href', 'data:text/plain;charset=utf-8,' + encodeURIComponent(text));\n"
-							<< "            element.setAttribute('download', 'ocr_result.txt');\n"
-							<< "            element.style.display = 'none';\n"
-							<< "            document.body.appendChild(element);\n"
-							<< "            element.click();\n"
-							<< "            document.body.removeChild(element);\n"
-							<< "        }\n"
-							<< "    </script>\n"
-							<< "</body>\n"
-							<< "</html>\n";
-						file.close();
-						QDesktopServices::openUrl(QUrl::fromLocalFile(htmlPath));
+				label->setText(statusText(result, refinement != nullptr));
+			}
+		}
+		capture.commit();
+
+		if (refinement) {
+			QPointer<QTextEdit> edit = textEdit;
+			QPointer<QLabel> status = label;
+			// Keeps the line under the pointer selected in the whole text
+			const QString pointerLine = result.word.isEmpty() ? QString() : result.text;
+			refinement->subscribe([edit, status, pointerLine](const OcrResult& better) {
+				if (edit && status && better.success) {
+					edit->setText(better.text);
+					if (!pointerLine.isEmpty()) {
+						edit->find(pointerLine);
 					}
-					return 0;
+					status->setText(statusText(better, true));
 				}
-				
-				window.show();
-				return app.exec();
-			}
+				});
 		}
 
-		result = extractText(tempPath, language);
-		if (!result.success) {
-			textEdit->setText("");
-			label->setText(result.errorMessage);
-		}
-		else {
-			textEdit->setText(result.text);
-			label->setText("Text extracted successfully.");
-			
-			// Auto-open in browser if requested
-			if (openInBrowser) {
-				QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
-				QString htmlPath = QDir::tempPath() + "/ocr_result_" + timestamp + ".html";
-				
-				QFile file(htmlPath);
-				if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-					QTextStream out(&file);
-					out << "<!DOCTYPE html>\n"
-						<< "<html lang=\"en\">\n"
-						<< "<head>\n"
-						<< "    <meta charset=\"UTF-8\">\n"
-						<< "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-						<< "    <title>OCR Results</title>\n"
-						<< "    <style>\n"
-						<< "        body {\n"
-						<< "            font-family: Arial, sans-serif;\n"
-						<< "            margin: 20px;\n"
-						<< "            line-height: 1.6;\n"
-						<< "            background-color: #f4f4f4;\n"
-						<< "        }\n"
-						<< "        .container {\n"
-						<< "            max-width: 800px;\n"
-						<< "            margin: 0 auto;\n"
-						<< "            background-color: white;\n"
-						<< "            padding: 20px;\n"
-						<< "            border-radius: 8px;\n"
-						<< "            box-shadow: 0 2px 4px rgba(0,0,0,0.1);\n"
-						<< "        }\n"
-						<< "        h1 {\n"
-						<< "            color: #333;\n"
-						<< "        }\n"
-						<< "        .timestamp {\n"
-						<< "            color: #666;\n"
-						<< "            font-size: 0.9em;\n"
-						<< "        }\n"
-						<< "        .content {\n"
-						<< "            width: 100%;\n"
-						<< "            min-height: 300px;\n"
-						<< "            padding: 15px;\n"
-						<< "            border: 2px solid #007bff;\n"
-						<< "            border-radius: 4px;\n"
-						<< "            font-family: 'Courier New', monospace;\n"
-						<< "            font-size: 14px;\n"
-						<< "            box-sizing: border-box;\n"
-						<< "            resize: vertical;\n"
-						<< "        }\n"
-						<< "        .button-group {\n"
-						<< "            margin-top: 15px;\n"
-						<< "            display: flex;\n"
-						<< "            gap: 10px;\n"
-						<< "        }\n"
-						<< "        button {\n"
-						<< "            padding: 10px 20px;\n"
-						<< "            background-color: #007bff;\n"
-						<< "            color: white;\n"
-						<< "            border: none;\n"
-						<< "            border-radius: 4px;\n"
-						<< "            cursor: pointer;\n"
-						<< "            font-size: 14px;\n"
-						<< "        }\n"
-						<< "        button:hover {\n"
-						<< "            background-color: #0056b3;\n"
-						<< "        }\n"
-						<< "    </style>\n"
-						<< "</head>\n"
-						<< "<body>\n"
-						<< "    <div class=\"container\">\n"
-						<< "        <h1>OCR Results</h1>\n"
-						<< "        <p class=\"timestamp\">Generated: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << "</p>\n"
-						<< "        <textarea id=\"content\" class=\"content\">" << result.text.toHtmlEscaped() << "</textarea>\n"
-						<< "        <div class=\"button-group\">\n"
-						<< "            <button onclick=\"copyText()\">Copy to Clipboard</button>\n"
-						<< "            <button onclick=\"downloadText()\">Download as TXT</button>\n"
-						<< "        </div>\n"
-						<< "    </div>\n"
-						<< "    <script>\n"
-						<< "        function copyText() {\n"
-						<< "            const textarea = document.getElementById('content');\n"
-						<< "            textarea.select();\n"
-						<< "            document.execCommand('copy');\n"
-						<< "            alert('Text copied to clipboard!');\n"
-						<< "        }\n"
-						<< "        function downloadText() {\n"
-						<< "            const textarea = document.getElementById('content');\n"
-						<< "            const text = textarea.value;\n"
-						<< "            const element = document.createElement('a');\n"
-						<< "            element.setAttribute('href', 'data:text/plain;charset=utf-8,' + encodeURIComponent(text));\n"
-						<< "            element.setAttribute('download', 'ocr_result.txt');\n"
-						<< "            element.style.display = 'none';\n"
-						<< "            document.body.appendChild(element);\n"
-						<< "            element.click();\n"
-						<< "            document.body.removeChild(element);\n"
-						<< "        }\n"
-						<< "    </script>\n"
-						<< "</body>\n"
-						<< "</html>\n";
-					file.close();
-					QDesktopServices::openUrl(QUrl::fromLocalFile(htmlPath));
-				}
-				return 0;
+		// Milestones for the first frame; the startup report is due once
+		// the text has been painted
+		Startup::markOnFirstPaint(&window, "window_shown");
+		Startup::markOnFirstPaint(textEdit->viewport(), "text_shown", [&]() {
+			startupSession.report();
+			if (parser.isSet(quitAfterTextOption)) {
+				QCoreApplication::quit();
 			}
-		}
+			});
 		window.show();
 	}
 	else {
+		capture.commit();
 		textEdit->setText("");
 		label->setText("Error occurred while taking screenshot");
 		window.show();
@@ -579,5 +713,5 @@ int main(int argc, char* argv[]) {
 			"Failed to launch Spectacle or take screenshot");
 	}
 
-	return app.exec();
+	return app->exec();
 }
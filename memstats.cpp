@@ -0,0 +1,305 @@
+#include "memstats.h"
+
+#include <QJsonObject>
+#include <QString>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "trace.h"
+
+namespace {
+
+	std::atomic<bool> s_counting{ false };
+	std::atomic<uint64_t> s_allocations{ 0 };
+	std::atomic<uint64_t> s_allocatedBytes{ 0 };
+
+}
+
+// Counting allocator hook. Array and nothrow forms forward here in
+// libstdc++, so this sees every C++ allocation made by us, Qt, Tesseract
+// and ZXing. Leptonica allocates with malloc and only shows up in the
+// heap numbers.
+void* operator new(std::size_t size) {
+	if (s_counting.load(std::memory_order_relaxed)) {
+		s_allocations.fetch_add(1, std::memory_order_relaxed);
+		s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	if (size == 0) {
+		size = 1;
+	}
+	for (;;) {
+		if (void* p = std::malloc(size)) {
+			return p;
+		}
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) {
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+namespace MemStats {
+
+	namespace {
+
+		struct OpenStage {
+			const char* name;
+			long tid;
+			int depth;
+			Snapshot before;
+			int64_t peak;
+		};
+
+		std::atomic<bool> s_enabled{ false };
+		std::mutex s_mutex;
+		std::vector<OpenStage> s_open;
+		std::vector<StageRecord> s_records;
+		int64_t s_processPeak = 0;
+		bool s_canResetPeak = true;
+
+		// Reads a small /proc file into a stack buffer; no heap allocation so
+		// the hooks do not disturb the numbers they report
+		ssize_t readProcFile(const char* path, char* buffer, size_t size) {
+			const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				return -1;
+			}
+			const ssize_t length = ::read(fd, buffer, size - 1);
+			::close(fd);
+			buffer[length > 0 ? length : 0] = '\0';
+			return length;
+		}
+
+		int64_t currentRss() {
+			char buffer[128];
+			if (readProcFile("/proc/self/statm", buffer, sizeof(buffer)) <= 0) {
+				return 0;
+			}
+			long long size = 0;
+			long long resident = 0;
+			std::sscanf(buffer, "%lld %lld", &size, &resident);
+			return resident * ::sysconf(_SC_PAGESIZE);
+		}
+
+		int64_t statusKib(const char* status, const char* key) {
+			const char* line = std::strstr(status, key);
+			return line ? std::strtoll(line + std::strlen(key), nullptr, 10) * 1024 : 0;
+		}
+
+		// VmHWM, the peak RSS since start or the last reset
+		int64_t highWaterRss() {
+			char buffer[4096];
+			if (readProcFile("/proc/self/status", buffer, sizeof(buffer)) <= 0) {
+				return 0;
+			}
+			return statusKib(buffer, "VmHWM:");
+		}
+
+		void resetHighWater() {
+			if (!s_canResetPeak) {
+				return;
+			}
+			const int fd = ::open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+			s_canResetPeak = fd >= 0 && ::write(fd, "5", 1) == 1;
+			if (fd >= 0) {
+				::close(fd);
+			}
+		}
+
+		// Folds the high-water mark into every open stage, since they all
+		// overlap the interval since the last reset
+		void collectPeak() {
+			const int64_t hwm = s_canResetPeak ? highWaterRss() : currentRss();
+			s_processPeak = std::max(s_processPeak, hwm);
+			for (OpenStage& stage : s_open) {
+				stage.peak = std::max(stage.peak, hwm);
+			}
+		}
+
+		void beginStage(const char* name) {
+			const Snapshot before = snapshot();
+			std::lock_guard<std::mutex> lock(s_mutex);
+			collectPeak();
+			s_open.push_back({ name, static_cast<long>(::syscall(SYS_gettid)),
+				static_cast<int>(s_open.size()), before, before.rssBytes });
+			resetHighWater();
+		}
+
+		void endStage(const char* name) {
+			const Snapshot after = snapshot();
+			const long tid = static_cast<long>(::syscall(SYS_gettid));
+			std::lock_guard<std::mutex> lock(s_mutex);
+			collectPeak();
+
+			// Stages can end out of order when several threads are in flight
+			for (auto it = s_open.rbegin(); it != s_open.rend(); ++it) {
+				if (it->tid == tid && std::strcmp(it->name, name) == 0) {
+					s_records.push_back({ it->name, it->depth, it->before, after,
+						std::max(it->peak, after.rssBytes) });
+					s_open.erase(std::next(it).base());
+					break;
+				}
+			}
+		}
+
+		Trace::SpanHooks s_hooks = { &beginStage, &endStage };
+
+		double mib(int64_t bytes) {
+			return bytes / (1024.0 * 1024.0);
+		}
+
+	}
+
+	Snapshot snapshot() {
+		Snapshot snap;
+		snap.rssBytes = currentRss();
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+		const struct mallinfo2 info = ::mallinfo2();
+		snap.heapBytes = static_cast<int64_t>(info.uordblks + info.hblkhd);
+#elif defined(__GLIBC__)
+		const struct mallinfo info = ::mallinfo();
+		snap.heapBytes = static_cast<int64_t>(static_cast<unsigned>(info.uordblks) + static_cast<unsigned>(info.hblkhd));
+#endif
+		snap.allocations = s_allocations.load(std::memory_order_relaxed);
+		snap.allocatedBytes = s_allocatedBytes.load(std::memory_order_relaxed);
+		return snap;
+	}
+
+	RssBreakdown rssBreakdown() {
+		RssBreakdown rss;
+		char buffer[4096];
+		if (readProcFile("/proc/self/status", buffer, sizeof(buffer)) > 0) {
+			rss.anonBytes = statusKib(buffer, "RssAnon:");
+			rss.fileBytes = statusKib(buffer, "RssFile:");
+			rss.shmemBytes = statusKib(buffer, "RssShmem:");
+		}
+		return rss;
+	}
+
+	void enable() {
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			s_records.reserve(256);
+			s_open.reserve(16);
+		}
+		s_counting.store(true, std::memory_order_relaxed);
+		s_enabled.store(true, std::memory_order_relaxed);
+		Trace::addSpanHooks(&s_hooks);
+	}
+
+	bool isEnabled() {
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	int64_t processPeakRssBytes() {
+		std::lock_guard<std::mutex> lock(s_mutex);
+		collectPeak();
+		return s_processPeak;
+	}
+
+	std::vector<StageRecord> takeRecords() {
+		std::lock_guard<std::mutex> lock(s_mutex);
+		std::vector<StageRecord> records;
+		records.swap(s_records);
+		s_records.reserve(256);
+		return records;
+	}
+
+	void printReport(const std::vector<StageRecord>& records, QTextStream& out) {
+		out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+			.arg("Stage (MiB)", -28)
+			.arg("RSS", 9)
+			.arg("RSS delta", 10)
+			.arg("peak", 9)
+			.arg("heap delta", 11)
+			.arg("allocs", 9)
+			.arg("alloc MiB", 10);
+
+		for (const StageRecord& record : records) {
+			const QString name = QString(record.depth * 2, ' ') + record.name;
+			out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+				.arg(name, -28)
+				.arg(mib(record.after.rssBytes), 9, 'f', 1)
+				.arg(mib(record.after.rssBytes - record.before.rssBytes), 10, 'f', 1)
+				.arg(mib(record.peakRssBytes), 9, 'f', 1)
+				.arg(mib(record.after.heapBytes - record.before.heapBytes), 11, 'f', 1)
+				.arg(static_cast<qint64>(record.after.allocations - record.before.allocations), 9)
+				.arg(mib(static_cast<int64_t>(record.after.allocatedBytes - record.before.allocatedBytes)), 10, 'f', 1);
+		}
+
+		out << "Process peak RSS: " << QString::number(mib(processPeakRssBytes()), 'f', 1) << " MiB";
+		if (!s_canResetPeak) {
+			out << " (per-stage peaks are sampled, /proc/self/clear_refs is not writable)";
+		}
+		out << "\n";
+	}
+
+	QJsonArray toJson(const std::vector<StageRecord>& records) {
+		struct Totals {
+			int count = 0;
+			int64_t rssDeltaMax = 0;
+			int64_t peakAboveStartMax = 0;
+			double heapDeltaSum = 0.0;
+			double allocationsSum = 0.0;
+			double allocatedBytesSum = 0.0;
+		};
+
+		std::map<std::string, Totals> byStage;
+		for (const StageRecord& record : records) {
+			Totals& totals = byStage[record.name];
+			++totals.count;
+			totals.rssDeltaMax = std::max(totals.rssDeltaMax, record.after.rssBytes - record.before.rssBytes);
+			totals.peakAboveStartMax = std::max(totals.peakAboveStartMax, record.peakRssBytes - record.before.rssBytes);
+			totals.heapDeltaSum += record.after.heapBytes - record.before.heapBytes;
+			totals.allocationsSum += record.after.allocations - record.before.allocations;
+			totals.allocatedBytesSum += record.after.allocatedBytes - record.before.allocatedBytes;
+		}
+
+		QJsonArray stages;
+		for (const auto& [name, totals] : byStage) {
+			QJsonObject stage;
+			stage["stage"] = QString::fromStdString(name);
+			stage["count"] = totals.count;
+			stage["rss_delta_max_bytes"] = static_cast<qint64>(totals.rssDeltaMax);
+			stage["peak_above_start_max_bytes"] = static_cast<qint64>(totals.peakAboveStartMax);
+			stage["heap_delta_mean_bytes"] = totals.heapDeltaSum / totals.count;
+			stage["allocations_mean"] = totals.allocationsSum / totals.count;
+			stage["allocated_bytes_mean"] = totals.allocatedBytesSum / totals.count;
+			stages.append(stage);
+		}
+		return stages;
+	}
+
+	Session::Session(bool enabled) : m_enabled(enabled) {
+		if (m_enabled) {
+			enable();
+		}
+	}
+
+	Session::~Session() {
+		if (m_enabled) {
+			QTextStream err(stderr);
+			printReport(takeRecords(), err);
+		}
+	}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QJsonArray>
+#include <QTextStream>
+#include <cstdint>
+#include <vector>
+
+// Per-stage memory accounting. Once enabled it hooks into the trace spans,
+// so every span also records RSS, malloc heap and operator new counts.
+namespace MemStats {
+
+	struct Snapshot {
+		int64_t rssBytes = 0;
+		int64_t heapBytes = 0;       // malloc heap in use, mmapped chunks included
+		uint64_t allocations = 0;    // operator new calls while counting
+		uint64_t allocatedBytes = 0;
+	};
+
+	struct StageRecord {
+		const char* name;
+		int depth;
+		Snapshot before;
+		Snapshot after;
+		int64_t peakRssBytes;  // Highest RSS while the stage was open
+	};
+
+	Snapshot snapshot();
+
+	// RSS split by what backs it. File pages, such as mapped traineddata,
+	// are shared with every other process mapping the same file.
+	struct RssBreakdown {
+		int64_t anonBytes = 0;
+		int64_t fileBytes = 0;
+		int64_t shmemBytes = 0;
+	};
+
+	RssBreakdown rssBreakdown();
+
+	void enable();
+	bool isEnabled();
+
+	// Highest RSS seen by any stage so far
+	int64_t processPeakRssBytes();
+
+	std::vector<StageRecord> takeRecords();
+
+	void printReport(const std::vector<StageRecord>& records, QTextStream& out);
+
+	// Aggregates records by stage name for the benchmark results
+	QJsonArray toJson(const std::vector<StageRecord>& records);
+
+	// Enables accounting for its lifetime and prints the report to stderr
+	// when it goes out of scope
+	class Session {
+	public:
+		explicit Session(bool enabled);
+		~Session();
+
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+
+	private:
+		bool m_enabled;
+	};
+
+}
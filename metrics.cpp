@@ -0,0 +1,285 @@
+#include "metrics.h"
+
+// qt imports
+#include <QHostAddress>
+#include <QSaveFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Metrics {
+
+	namespace {
+
+		enum class Type { Counter, Gauge, Histogram };
+
+		struct Family {
+			Type type;
+			std::string help;
+			std::vector<double> buckets;  // Upper bounds, ascending, +Inf implied
+		};
+
+		struct HistogramValue {
+			std::vector<double> buckets;   // Copied from the family on first use
+			std::vector<uint64_t> counts;  // Per bucket plus +Inf, not cumulative
+			uint64_t count = 0;
+			double sum = 0.0;
+		};
+
+		// Metric name -> label string -> value
+		template<typename T>
+		using Series = std::map<std::string, std::map<std::string, T>>;
+
+		// One per thread; its mutex is only contended while a scrape reads it
+		struct Shard {
+			std::mutex mutex;
+			Series<double> counters;
+			Series<HistogramValue> histograms;
+		};
+
+		struct Registry {
+			std::mutex mutex;
+			std::map<std::string, Family> families;
+			std::vector<std::unique_ptr<Shard>> shards;
+			Series<double> gauges;
+		};
+
+		Registry& registry() {
+			static Registry instance;
+			return instance;
+		}
+
+		Shard& threadShard() {
+			// Shards are owned by the registry so counts outlive their thread
+			thread_local Shard* shard = [] {
+				auto owned = std::make_unique<Shard>();
+				Shard* raw = owned.get();
+				Registry& reg = registry();
+				std::lock_guard<std::mutex> lock(reg.mutex);
+				reg.shards.push_back(std::move(owned));
+				return raw;
+			}();
+			return *shard;
+		}
+
+		void describe(const char* name, Type type, const char* help, std::vector<double> buckets = {}) {
+			std::sort(buckets.begin(), buckets.end());
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			reg.families[name] = { type, help, std::move(buckets) };
+		}
+
+		std::vector<double> bucketsOf(const char* name) {
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			auto family = reg.families.find(name);
+			return family == reg.families.end() ? std::vector<double>() : family->second.buckets;
+		}
+
+		QByteArray number(double value) {
+			if (value == static_cast<double>(static_cast<int64_t>(value)) && std::abs(value) < 1e15) {
+				return QByteArray::number(static_cast<qint64>(value));
+			}
+			return QByteArray::number(value, 'g', 12);
+		}
+
+		QByteArray series(const std::string& name, const char* suffix, const std::string& labels, const QByteArray& extraLabel = QByteArray()) {
+			QByteArray line = QByteArray::fromStdString(name) + suffix;
+			if (!labels.empty() || !extraLabel.isEmpty()) {
+				line += '{' + QByteArray::fromStdString(labels);
+				if (!labels.empty() && !extraLabel.isEmpty()) {
+					line += ',';
+				}
+				line += extraLabel + '}';
+			}
+			return line;
+		}
+
+	}
+
+	std::string labels(std::initializer_list<std::pair<const char*, QString>> pairs) {
+		std::string text;
+		for (const auto& [name, value] : pairs) {
+			if (!text.empty()) {
+				text += ',';
+			}
+			text += name;
+			text += "=\"";
+			for (const char c : value.toStdString()) {
+				if (c == '\\' || c == '"') {
+					text += '\\';
+					text += c;
+				}
+				else if (c == '\n') {
+					text += "\\n";
+				}
+				else {
+					text += c;
+				}
+			}
+			text += '"';
+		}
+		return text;
+	}
+
+	void describeCounter(const char* name, const char* help) {
+		describe(name, Type::Counter, help);
+	}
+
+	void describeGauge(const char* name, const char* help) {
+		describe(name, Type::Gauge, help);
+	}
+
+	void describeHistogram(const char* name, const char* help, std::vector<double> buckets) {
+		describe(name, Type::Histogram, help, std::move(buckets));
+	}
+
+	void increment(const char* name, const std::string& labels, double value) {
+		Shard& shard = threadShard();
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.counters[name][labels] += value;
+	}
+
+	void observe(const char* name, double value, const std::string& labels) {
+		Shard& shard = threadShard();
+		std::unique_lock<std::mutex> lock(shard.mutex);
+		auto& byLabels = shard.histograms[name];
+		auto it = byLabels.find(labels);
+		if (it == byLabels.end()) {
+			// The bucket layout is looked up once per series and thread
+			lock.unlock();
+			HistogramValue fresh;
+			fresh.buckets = bucketsOf(name);
+			fresh.counts.assign(fresh.buckets.size() + 1, 0);
+			lock.lock();
+			it = byLabels.emplace(labels, std::move(fresh)).first;
+		}
+
+		HistogramValue& histogram = it->second;
+		const size_t bucket = std::lower_bound(histogram.buckets.begin(), histogram.buckets.end(), value)
+			- histogram.buckets.begin();
+		++histogram.counts[bucket];
+		++histogram.count;
+		histogram.sum += value;
+	}
+
+	void setGauge(const char* name, double value, const std::string& labels) {
+		Registry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		reg.gauges[name][labels] = value;
+	}
+
+	void addGauge(const char* name, double delta, const std::string& labels) {
+		Registry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		reg.gauges[name][labels] += delta;
+	}
+
+	QByteArray scrape() {
+		Registry& reg = registry();
+		std::lock_guard<std::mutex> registryLock(reg.mutex);
+
+		// Sum the shards first, so no shard is held while formatting
+		Series<double> counters;
+		Series<HistogramValue> histograms;
+		for (const auto& shard : reg.shards) {
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			for (const auto& [name, byLabels] : shard->counters) {
+				for (const auto& [labels, value] : byLabels) {
+					counters[name][labels] += value;
+				}
+			}
+			for (const auto& [name, byLabels] : shard->histograms) {
+				for (const auto& [labels, value] : byLabels) {
+					HistogramValue& total = histograms[name][labels];
+					total.counts.resize(std::max(total.counts.size(), value.counts.size()), 0);
+					for (size_t i = 0; i < value.counts.size(); ++i) {
+						total.counts[i] += value.counts[i];
+					}
+					total.count += value.count;
+					total.sum += value.sum;
+				}
+			}
+		}
+
+		QByteArray out;
+		for (const auto& [name, family] : reg.families) {
+			const char* type = family.type == Type::Counter ? "counter" : family.type == Type::Gauge ? "gauge" : "histogram";
+			out += "# HELP " + QByteArray::fromStdString(name) + ' ' + QByteArray::fromStdString(family.help) + '\n';
+			out += "# TYPE " + QByteArray::fromStdString(name) + ' ' + type + '\n';
+
+			if (family.type == Type::Histogram) {
+				for (const auto& [labels, histogram] : histograms[name]) {
+					uint64_t cumulative = 0;
+					for (size_t i = 0; i < family.buckets.size(); ++i) {
+						cumulative += i < histogram.counts.size() ? histogram.counts[i] : 0;
+						out += series(name, "_bucket", labels, "le=\"" + number(family.buckets[i]) + '"')
+							+ ' ' + number(static_cast<double>(cumulative)) + '\n';
+					}
+					out += series(name, "_bucket", labels, "le=\"+Inf\"") + ' ' + number(static_cast<double>(histogram.count)) + '\n';
+					out += series(name, "_sum", labels) + ' ' + number(histogram.sum) + '\n';
+					out += series(name, "_count", labels) + ' ' + number(static_cast<double>(histogram.count)) + '\n';
+				}
+			}
+			else {
+				const auto& values = family.type == Type::Counter ? counters[name] : reg.gauges[name];
+				for (const auto& [labels, value] : values) {
+					out += series(name, "", labels) + ' ' + number(value) + '\n';
+				}
+			}
+		}
+		return out;
+	}
+
+	bool serveOnLoopback(quint16 port, QObject* parent) {
+		auto* server = new QTcpServer(parent);
+		if (!server->listen(QHostAddress::LocalHost, port)) {
+			delete server;
+			return false;
+		}
+
+		QObject::connect(server, &QTcpServer::newConnection, [server]() {
+			while (QTcpSocket* socket = server->nextPendingConnection()) {
+				QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+				QObject::connect(socket, &QTcpSocket::readyRead, [socket]() {
+					// Only the request line matters; headers are ignored
+					if (!socket->canReadLine()) {
+						return;
+					}
+					const QByteArray requestLine = socket->readLine();
+					socket->readAll();
+
+					const bool found = requestLine.startsWith("GET /metrics ") || requestLine.startsWith("GET / ");
+					const QByteArray body = found ? scrape() : QByteArray("Not found\n");
+					socket->write(QByteArray(found ? "HTTP/1.0 200 OK\r\n" : "HTTP/1.0 404 Not Found\r\n")
+						+ "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+						+ "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+						+ "Connection: close\r\n\r\n" + body);
+					socket->disconnectFromHost();
+					});
+			}
+			});
+		return true;
+	}
+
+	void writeFilePeriodically(const QString& path, int intervalMs, QObject* parent) {
+		auto write = [path]() {
+			QSaveFile file(path);
+			if (file.open(QIODevice::WriteOnly)) {
+				file.write(scrape());
+				file.commit();
+			}
+		};
+
+		auto* timer = new QTimer(parent);
+		QObject::connect(timer, &QTimer::timeout, write);
+		timer->start(intervalMs);
+		write();
+	}
+
+}
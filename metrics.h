@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Counters, gauges and histograms in the Prometheus text format. Counters
+// and histograms are kept in per-thread shards, so updates only take a lock
+// nobody else holds except during a scrape, and are summed on scrape.
+namespace Metrics {
+
+	// Formats label pairs as name="value",... with Prometheus escaping
+	std::string labels(std::initializer_list<std::pair<const char*, QString>> pairs);
+
+	// Every metric name is described once before use; help and buckets are
+	// only used for the exposition
+	void describeCounter(const char* name, const char* help);
+	void describeGauge(const char* name, const char* help);
+	void describeHistogram(const char* name, const char* help, std::vector<double> buckets);
+
+	void increment(const char* name, const std::string& labels = std::string(), double value = 1.0);
+	void observe(const char* name, double value, const std::string& labels = std::string());
+
+	// Gauges are set process-wide; the last write wins
+	void setGauge(const char* name, double value, const std::string& labels = std::string());
+	void addGauge(const char* name, double delta, const std::string& labels = std::string());
+
+	QByteArray scrape();
+
+	// Serves scrape() at http://127.0.0.1:<port>/metrics on the calling
+	// thread's event loop
+	bool serveOnLoopback(quint16 port, QObject* parent);
+
+	// Rewrites path atomically every intervalMs, in the format the node
+	// exporter's textfile collector picks up
+	void writeFilePeriodically(const QString& path, int intervalMs, QObject* parent);
+
+}
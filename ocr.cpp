@@ -0,0 +1,766 @@
+#include "ocr.h"
+
+#include <leptonica/allheaders.h>
+#include <tesseract/baseapi.h>
+#include <tesseract/ocrclass.h>
+#include <tesseract/resultiterator.h>
+// qt imports
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QProcess>
+#include <QRect>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dlfcn.h>
+#include "bufferpool.h"
+#include "kernels.h"
+#include "qrplugin.h"
+#include "segmentation.h"
+#include "startup.h"
+#include "stripes.h"
+#include "trace.h"
+#include "traineddata.h"
+
+bool OcrOptions::preprocesses() const {
+	return scale != 1.0 || grayscale || invertDark || binarizeThreshold > 0;
+}
+
+QString defaultOcrProfilePath() {
+	return QStandardPaths::writableLocation(QStandardPaths::ConfigLocation)
+		+ "/spectacle-ocr-screenshot/profile.ini";
+}
+
+OcrOptions loadOcrProfile(const QString& path) {
+	OcrOptions options;
+	if (!QFile::exists(path)) {
+		return options;
+	}
+
+	QSettings settings(path, QSettings::IniFormat);
+	options.oem = settings.value("engine/oem", options.oem).toInt();
+	options.psm = settings.value("engine/psm", options.psm).toInt();
+	options.scale = settings.value("preprocess/scale", options.scale).toDouble();
+	options.grayscale = settings.value("preprocess/grayscale", options.grayscale).toBool();
+	options.invertDark = settings.value("preprocess/invert_dark", options.invertDark).toBool();
+	options.binarizeThreshold = settings.value("preprocess/binarize_threshold", options.binarizeThreshold).toInt();
+	options.cascadeConfidence = settings.value("engine/cascade_confidence", options.cascadeConfidence).toInt();
+
+	settings.beginGroup("params");
+	for (const QString& name : settings.childKeys()) {
+		options.params[name] = settings.value(name).toString();
+	}
+	settings.endGroup();
+
+	if (options.scale <= 0.0) {
+		options.scale = 1.0;
+	}
+	return options;
+}
+
+bool saveOcrProfile(const QString& path, const OcrOptions& options) {
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	QSettings settings(path, QSettings::IniFormat);
+	settings.setValue("engine/oem", options.oem);
+	settings.setValue("engine/psm", options.psm);
+	settings.setValue("preprocess/scale", options.scale);
+	settings.setValue("preprocess/grayscale", options.grayscale);
+	settings.setValue("preprocess/invert_dark", options.invertDark);
+	settings.setValue("preprocess/binarize_threshold", options.binarizeThreshold);
+	settings.setValue("engine/cascade_confidence", options.cascadeConfidence);
+
+	settings.remove("params");
+	settings.beginGroup("params");
+	for (auto it = options.params.constBegin(); it != options.params.constEnd(); ++it) {
+		settings.setValue(it.key(), it.value());
+	}
+	settings.endGroup();
+
+	settings.sync();
+	return settings.status() == QSettings::NoError;
+}
+
+bool initEngine(tesseract::TessBaseAPI& ocr, const QString& language, const OcrOptions& options,
+	const QString& dataDirectory) {
+	// Passing variables to Init() rather than SetVariable() afterwards also
+	// covers the init-only ones, such as the dictionary switches
+	std::vector<std::string> names;
+	std::vector<std::string> values;
+	for (auto it = options.params.constBegin(); it != options.params.constEnd(); ++it) {
+		names.push_back(it.key().toStdString());
+		values.push_back(it.value().toStdString());
+	}
+
+	// Init() copies every component out of the mapping into Tesseract's own
+	// heap, so the mapping is only held for its duration and only spares
+	// the buffer Tesseract would read the file into; nothing stays shared
+	const QByteArray lang = language.toUtf8();
+	const auto mode = static_cast<tesseract::OcrEngineMode>(options.oem);
+	const std::unique_ptr<Traineddata::Mapping> traineddata = dataDirectory.isEmpty()
+		? Traineddata::map(language) : Traineddata::map(language, dataDirectory);
+	const QByteArray datapath = QFile::encodeName(dataDirectory);
+	const int status = traineddata
+		? ocr.Init(traineddata->data(), static_cast<int>(traineddata->size()), lang.constData(), mode,
+			nullptr, 0, &names, &values, false, nullptr)
+		: ocr.Init(dataDirectory.isEmpty() ? nullptr : datapath.constData(), lang.constData(), mode,
+			nullptr, 0, &names, &values, false);
+	if (status) {
+		return false;
+	}
+
+	// Init() only warns about unknown variables
+	std::string unused;
+	for (const std::string& name : names) {
+		if (!ocr.GetVariableAsString(name.c_str(), &unused)) {
+			ocr.End();
+			return false;
+		}
+	}
+
+	ocr.SetPageSegMode(static_cast<tesseract::PageSegMode>(options.psm));
+	return true;
+}
+
+QImage preprocessForOcr(const QImage& source, const OcrOptions& options) {
+	QImage image = source;
+	if (options.scale != 1.0) {
+		image = image.scaled(qRound(image.width() * options.scale), qRound(image.height() * options.scale),
+			Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	}
+
+	const Kernels::Table& kernels = Kernels::table();
+	const bool gray = options.grayscale || options.binarizeThreshold > 0;
+	if (gray && (image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32)) {
+		// Screenshots load as RGB32, which the kernel reads directly
+		QImage grayImage = BufferPool::image(image.size(), QImage::Format_Grayscale8);
+		grayImage.setDotsPerMeterX(image.dotsPerMeterX());
+		grayImage.setDotsPerMeterY(image.dotsPerMeterY());
+		for (int y = 0; y < image.height(); ++y) {
+			kernels.grayscale(image.constScanLine(y), grayImage.scanLine(y), image.width());
+		}
+		image = grayImage;
+	}
+	else {
+		image = image.convertToFormat(gray ? QImage::Format_Grayscale8 : QImage::Format_RGB888);
+	}
+
+	if (options.invertDark) {
+		// Screenshots are mostly background, so the mean tells the theme
+		const QImage luminance = gray ? image : image.convertToFormat(QImage::Format_Grayscale8);
+		uint64_t sum = 0;
+		for (int y = 0; y < luminance.height(); ++y) {
+			sum += kernels.sum(luminance.constScanLine(y), luminance.width());
+		}
+		const uint64_t pixels = static_cast<uint64_t>(luminance.width()) * luminance.height();
+		if (pixels > 0 && sum / pixels < 128) {
+			image.invertPixels();
+		}
+	}
+
+	if (options.binarizeThreshold > 0) {
+		const uint8_t threshold = static_cast<uint8_t>(qBound(0, options.binarizeThreshold, 255));
+		for (int y = 0; y < image.height(); ++y) {
+			kernels.threshold(image.scanLine(y), image.width(), threshold);
+		}
+	}
+	return image;
+}
+
+bool takeScreenshot(const QString& outputPath, CaptureArea area) {
+	TRACE_SCOPE("spectacle");
+	// -m is the monitor the pointer is on
+	int exitCode = QProcess::execute("spectacle", QStringList()
+		<< "-b" << (area == CaptureArea::CurrentMonitor ? "-m" : "-r") << "-n" << "-o" << outputPath);
+	return exitCode == 0;
+}
+
+OcrResult detectQrCode(const QString& imagePath) {
+	QImage image;
+	{
+		TRACE_SCOPE("qr.decode_png");
+		if (Stripes::isLarge(QImageReader(imagePath).size())) {
+			// ZXing only looks at luminance
+			image = Stripes::loadGray(imagePath);
+		}
+		if (image.isNull()) {
+			image = BufferPool::load(imagePath);
+		}
+	}
+	if (image.isNull()) {
+		OcrResult result;
+		result.success = false;
+		result.errorMessage = "Failed to load image for QR detection";
+		return result;
+	}
+
+	return detectQrCode(image);
+}
+
+namespace {
+
+#ifndef OCR_PLUGIN_INSTALL_DIR
+#define OCR_PLUGIN_INSTALL_DIR "/usr/local/lib/spectacle-ocr-screenshot"
+#endif
+
+	const OcrQrPlugin* loadQrPlugin() {
+#ifdef OCR_QR_BUILTIN
+		return spectacle_ocr_qr_plugin();
+#else
+		TRACE_SCOPE("qr.load_plugin");
+		const std::string file = "libspectacle-ocr-qr.so";
+
+		// $OCR_PLUGIN_DIR, next to the module holding this code (the
+		// executable or libspectacle-ocr.so), then the install directory
+		std::vector<std::string> candidates;
+		if (const char* dir = std::getenv("OCR_PLUGIN_DIR")) {
+			candidates.push_back(std::string(dir) + "/" + file);
+		}
+		Dl_info info;
+		if (dladdr(reinterpret_cast<void*>(&loadQrPlugin), &info) && info.dli_fname) {
+			const std::string module = info.dli_fname;
+			const size_t slash = module.rfind('/');
+			candidates.push_back((slash == std::string::npos ? std::string(".") : module.substr(0, slash)) + "/" + file);
+		}
+		candidates.push_back(std::string(OCR_PLUGIN_INSTALL_DIR) + "/" + file);
+
+		for (const std::string& path : candidates) {
+			void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+			if (!handle) {
+				continue;
+			}
+			const auto entry = reinterpret_cast<OcrQrPluginEntry>(dlsym(handle, OCR_QR_PLUGIN_ENTRY));
+			const OcrQrPlugin* plugin = entry ? entry() : nullptr;
+			if (plugin && plugin->version == OCR_QR_PLUGIN_VERSION) {
+				return plugin;
+			}
+			dlclose(handle);
+		}
+		return nullptr;
+#endif
+	}
+
+	// Loaded once and never unloaded
+	const OcrQrPlugin* qrPlugin() {
+		static const OcrQrPlugin* plugin = loadQrPlugin();
+		return plugin;
+	}
+
+}
+
+void preloadQrPlugin() {
+	qrPlugin();
+}
+
+OcrResult detectQrCode(const QImage& source) {
+	OcrResult result;
+	result.success = false;
+
+	const OcrQrPlugin* plugin = qrPlugin();
+	if (!plugin) {
+		result.errorMessage = "QR detection plugin not available";
+		return result;
+	}
+
+	QImage image = source;
+
+	// Layouts ZXing reads directly are not converted, so callers' buffers
+	// wrapped in a QImage are not copied
+	int format = OCR_QR_FORMAT_BGRA;
+	if (image.format() == QImage::Format_RGBA8888 || image.format() == QImage::Format_RGBX8888) {
+		format = OCR_QR_FORMAT_RGBA;
+	}
+	else if (image.format() == QImage::Format_Grayscale8) {
+		format = OCR_QR_FORMAT_LUM;
+	}
+	else if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32) {
+		// Convert image to RGB32 to ensure consistent format
+		TRACE_SCOPE("qr.convert");
+		image = image.convertToFormat(QImage::Format_RGB32);
+	}
+
+	const uchar* data = image.constBits();
+	int width = image.width();
+	int height = image.height();
+	int bytesPerLine = image.bytesPerLine();
+
+	Trace::Span readSpan("qr.zxing");
+	char* text = plugin->decode(data, width, height, bytesPerLine, format);
+	readSpan.setDetail(QString("%1x%2").arg(width).arg(height));
+	readSpan.end();
+
+	if (text) {
+		result.text = QString::fromUtf8(text);
+		result.success = true;
+		result.isQrCode = true;
+		result.configuration = "qr";
+		std::free(text);
+	}
+	else {
+		result.errorMessage = "Failed to detect valid QR code";
+	}
+
+	return result;
+}
+
+namespace {
+
+	// Tesseract polls this between words
+	bool cancelRequested(void* cancel, int) {
+		return static_cast<const std::atomic<bool>*>(cancel)->load(std::memory_order_relaxed);
+	}
+
+	OcrResult cancelledError() {
+		OcrResult result;
+		result.success = false;
+		result.errorMessage = "Recognition cancelled";
+		return result;
+	}
+
+	// The page segmentation mode for the layout of the image set on the
+	// engine. Tesseract keeps the thresholded image for recognizing it, so
+	// this costs only the projection profiles.
+	tesseract::PageSegMode pageSegModeFor(tesseract::TessBaseAPI& ocr) {
+		Trace::Span span("ocr.segmentation");
+		// jpn_vert and the like read a vertical block best as one
+		const bool verticalModel = QString::fromLatin1(ocr.GetInitLanguagesAsString()).contains("_vert");
+		Pix* binary = ocr.GetThresholdedImage();
+		const Segmentation::Layout layout = Segmentation::classify(binary, verticalModel);
+		pixDestroy(&binary);
+		span.setDetail(QString::fromLatin1(Segmentation::name(layout)));
+		return static_cast<tesseract::PageSegMode>(Segmentation::pageSegMode(layout));
+	}
+
+	// Runs layout analysis and recognition on the image, or the rectangle
+	// of it, set on the engine. analysed if AnalyseLayout() has run on it,
+	// whose blocks Tesseract then recognizes as they are. Returns false if
+	// cancel was set before it finished.
+	bool recognize(tesseract::TessBaseAPI& ocr, const std::atomic<bool>* cancel, bool analysed = false) {
+		TRACE_SCOPE("ocr.recognize");
+		// Fully automatic is the default; a line or a block needs less. The
+		// engine goes back to it for the next image.
+		const tesseract::PageSegMode mode = ocr.GetPageSegMode();
+		if (!analysed && mode == tesseract::PSM_AUTO && Segmentation::isEnabled()) {
+			ocr.SetPageSegMode(pageSegModeFor(ocr));
+		}
+		if (cancel) {
+			tesseract::ETEXT_DESC monitor;
+			monitor.cancel = cancelRequested;
+			monitor.cancel_this = const_cast<std::atomic<bool>*>(cancel);
+			ocr.Recognize(&monitor);
+		}
+		else {
+			ocr.Recognize(nullptr);
+		}
+		ocr.SetPageSegMode(mode);
+		return !cancel || !cancel->load(std::memory_order_relaxed);
+	}
+
+	bool recognizeText(tesseract::TessBaseAPI& ocr, const std::atomic<bool>* cancel, QString& text,
+		bool analysed = false) {
+		// GetUTF8Text() would otherwise recognize implicitly and hide the
+		// cost in the text span
+		if (!recognize(ocr, cancel, analysed)) {
+			return false;
+		}
+
+		char* outText;
+		{
+			TRACE_SCOPE("ocr.get_text");
+			outText = ocr.GetUTF8Text();
+		}
+		text = QString::fromUtf8(outText);
+		delete[] outText;
+		return true;
+	}
+
+	// Recognizes the image set on the engine and clears it afterwards
+	OcrResult recognizeCurrentImage(tesseract::TessBaseAPI& ocr, const std::atomic<bool>* cancel,
+		bool analysed = false) {
+		OcrResult result;
+		result.success = recognizeText(ocr, cancel, result.text, analysed);
+		ocr.Clear();
+		return result.success ? result : cancelledError();
+	}
+
+	// Takes a 1-bit page from Stripes::loadBinary(). Tesseract's working
+	// copies of the image and its layout only ever cover one band.
+	OcrResult recognizeBands(tesseract::TessBaseAPI& ocr, Pix* page, const std::atomic<bool>* cancel) {
+		const int width = pixGetWidth(page);
+		const std::vector<int> ends = Stripes::bandEnds(page);
+		ocr.SetImage(page);
+		pixDestroy(&page);
+
+		OcrResult result;
+		result.success = true;
+		int top = 0;
+		for (int end : ends) {
+			ocr.SetRectangle(0, top, width, end - top);
+			QString band;
+			if (!recognizeText(ocr, cancel, band)) {
+				ocr.Clear();
+				return cancelledError();
+			}
+			result.text += band;
+			top = end;
+		}
+		ocr.Clear();
+		return result;
+	}
+
+	OcrResult imageLoadError() {
+		OcrResult result;
+		result.success = false;
+		result.errorMessage = "Failed to load image";
+		return result;
+	}
+
+	// Hands the image to the engine, preprocessed if the options ask for it
+	bool setImage(tesseract::TessBaseAPI& ocr, const QImage& image, const OcrOptions& options) {
+		// Byte-ordered layouts go to Tesseract as they are; it copies them into
+		// its own image either way
+		const QImage::Format format = image.format();
+		if (!options.preprocesses() && (format == QImage::Format_Grayscale8 || format == QImage::Format_RGB888
+			|| format == QImage::Format_RGBA8888 || format == QImage::Format_RGBX8888)) {
+			ocr.SetImage(image.constBits(), image.width(), image.height(),
+				image.depth() / 8, static_cast<int>(image.bytesPerLine()));
+			const int dpi = qRound(image.dotsPerMeterX() * 0.0254);
+			if (dpi > 0) {
+				ocr.SetSourceResolution(dpi);
+			}
+			return true;
+		}
+
+		// Qt's native 32-bit layouts are BGRA in memory, which Tesseract would
+		// read as RGBA
+		QImage processed;
+		{
+			TRACE_SCOPE("ocr.preprocess");
+			processed = preprocessForOcr(image, options);
+		}
+		if (processed.isNull()) {
+			return false;
+		}
+
+		// Tesseract copies the pixels, so the QImage may go away afterwards
+		ocr.SetImage(processed.constBits(), processed.width(), processed.height(),
+			processed.depth() / 8, static_cast<int>(processed.bytesPerLine()));
+		const int dpi = qRound(processed.dotsPerMeterX() * 0.0254 * options.scale);
+		if (dpi > 0) {
+			ocr.SetSourceResolution(dpi);
+		}
+		return true;
+	}
+
+	// Window recognized around the pointer: a few lines of UI text at
+	// typical scale factors, small enough to take tens of milliseconds
+	constexpr int kNearWidth = 960;
+	constexpr int kNearHeight = 240;
+
+	// Distance from the point to the box, with vertical distance weighted
+	// up so a word on the same line wins over one just above or below
+	qint64 distanceTo(const QPoint& point, int left, int top, int right, int bottom) {
+		const qint64 dx = std::max({ left - point.x(), 0, point.x() - right });
+		const qint64 dy = std::max({ top - point.y(), 0, point.y() - bottom });
+		return dx * dx + 4 * dy * dy;
+	}
+
+}
+
+OcrResult extractText(const QString& imagePath, const QString& language, const OcrOptions& options) {
+	OcrEngine engine(language, options);
+	return engine.recognize(imagePath);
+}
+
+OcrResult extractText(tesseract::TessBaseAPI& ocr, const QString& imagePath, const OcrOptions& options,
+	const std::atomic<bool>* cancel) {
+	// Scaling needs the whole image; large captures are sharp enough
+	// without it
+	if (options.scale == 1.0 && Stripes::isLarge(QImageReader(imagePath).size())) {
+		if (Pix* page = Stripes::loadBinary(imagePath, options)) {
+			return recognizeBands(ocr, page, cancel);
+		}
+	}
+
+	if (options.preprocesses()) {
+		QImage image;
+		{
+			TRACE_SCOPE("ocr.load_image");
+			image = BufferPool::load(imagePath);
+		}
+		if (image.isNull()) {
+			return imageLoadError();
+		}
+		return extractText(ocr, image, options, cancel);
+	}
+
+	Pix* image = nullptr;
+	{
+		TRACE_SCOPE("ocr.load_image");
+		image = pixRead(imagePath.toUtf8().constData());
+	}
+	if (!image) {
+		return imageLoadError();
+	}
+
+	ocr.SetImage(image);
+	OcrResult result = recognizeCurrentImage(ocr, cancel);
+	pixDestroy(&image);
+	return result;
+}
+
+OcrResult extractText(tesseract::TessBaseAPI& ocr, const QImage& image, const OcrOptions& options,
+	const std::atomic<bool>* cancel) {
+	if (!setImage(ocr, image, options)) {
+		return imageLoadError();
+	}
+	return recognizeCurrentImage(ocr, cancel);
+}
+
+OcrResult extractTextNear(tesseract::TessBaseAPI& ocr, const QString& imagePath, const QPoint& point,
+	const OcrOptions& options, const std::atomic<bool>* cancel) {
+	QImage image;
+	QRect window;
+	{
+		TRACE_SCOPE("ocr.load_window");
+		QImageReader reader(imagePath);
+		if (!reader.canRead() || !reader.size().isValid()) {
+			return imageLoadError();
+		}
+		const QRect bounds(QPoint(0, 0), reader.size());
+		window = QRect(point.x() - kNearWidth / 2, point.y() - kNearHeight / 2, kNearWidth, kNearHeight)
+			.intersected(bounds);
+		if (window.isEmpty()) {
+			OcrResult result;
+			result.success = false;
+			result.errorMessage = "Pointer is outside the capture";
+			return result;
+		}
+		// Decoders that cannot clip decode everything and crop afterwards
+		reader.setClipRect(window);
+		image = reader.read();
+	}
+	if (image.isNull() || !setImage(ocr, image, options)) {
+		return imageLoadError();
+	}
+	if (!recognize(ocr, cancel)) {
+		ocr.Clear();
+		return cancelledError();
+	}
+
+	// Boxes are in the coordinates of the scaled window
+	const QPoint target((point.x() - window.x()) * options.scale, (point.y() - window.y()) * options.scale);
+	OcrResult result;
+	result.success = true;
+	std::unique_ptr<tesseract::ResultIterator> words(ocr.GetIterator());
+	if (words && !words->Empty(tesseract::RIL_WORD)) {
+		TRACE_SCOPE("ocr.nearest_word");
+		QString line;
+		qint64 nearest = -1;
+		do {
+			if (words->IsAtBeginningOf(tesseract::RIL_TEXTLINE)) {
+				line.clear();
+			}
+			char* text = words->GetUTF8Text(tesseract::RIL_WORD);
+			const QString word = QString::fromUtf8(text);
+			delete[] text;
+			line += (line.isEmpty() ? "" : " ") + word;
+
+			int left, top, right, bottom;
+			if (words->BoundingBox(tesseract::RIL_WORD, &left, &top, &right, &bottom)) {
+				const qint64 distance = distanceTo(target, left, top, right, bottom);
+				if (nearest < 0 || distance < nearest) {
+					nearest = distance;
+					result.word = word;
+					result.text.clear();
+				}
+			}
+			// The line of the nearest word is complete at its last word
+			if (result.text.isEmpty() && !result.word.isEmpty()
+				&& words->IsAtFinalElement(tesseract::RIL_TEXTLINE, tesseract::RIL_WORD)) {
+				result.text = line;
+			}
+		} while (words->Next(tesseract::RIL_WORD));
+	}
+	ocr.Clear();
+	if (result.word.isEmpty()) {
+		result.success = false;
+		result.errorMessage = "No text near the pointer";
+	}
+	return result;
+}
+
+OcrEngine::OcrEngine(const QString& language, const OcrOptions& options, const QString& dataDirectory)
+	: m_api(std::make_unique<tesseract::TessBaseAPI>()), m_language(language), m_options(options) {
+	Trace::Span initSpan("ocr.init");
+	initSpan.setDetail(language);
+	m_valid = initEngine(*m_api, language, options, dataDirectory);
+	initSpan.end();
+	if (m_valid) {
+		Startup::mark("engine_ready");
+	}
+
+	const QString bestDirectory = Traineddata::bestDirectory();
+	if (m_valid && options.cascadeConfidence > 0 && dataDirectory.isEmpty()
+		&& Traineddata::hasLanguage(bestDirectory, language)) {
+		// Always given one line at a time
+		OcrOptions lineOptions = options;
+		lineOptions.psm = tesseract::PSM_SINGLE_LINE;
+		Trace::Span bestSpan("ocr.init_best");
+		bestSpan.setDetail(language);
+		m_best = std::make_unique<tesseract::TessBaseAPI>();
+		if (!initEngine(*m_best, language, lineOptions, bestDirectory)) {
+			// Without it the fast models do everything
+			m_best.reset();
+		}
+	}
+}
+
+OcrEngine::~OcrEngine() {
+	if (m_best) {
+		m_best->End();
+	}
+	if (m_valid) {
+		m_api->End();
+	}
+}
+
+OcrResult OcrEngine::recognize(const QString& imagePath) {
+	return recognize(imagePath, m_options, nullptr);
+}
+
+OcrResult OcrEngine::recognize(const QImage& image) {
+	if (!m_valid) {
+		return initError();
+	}
+	return m_best && m_options.cascadeConfidence > 0
+		? recognizeCascade(image, m_options, nullptr) : extractText(*m_api, image, m_options);
+}
+
+OcrResult OcrEngine::recognize(const QString& imagePath, const OcrOptions& options, const std::atomic<bool>* cancel) {
+	if (!m_valid) {
+		return initError();
+	}
+	// Large captures are recognized in bands and stay with the fast models
+	if (!m_best || options.cascadeConfidence <= 0
+		|| (options.scale == 1.0 && Stripes::isLarge(QImageReader(imagePath).size()))) {
+		return extractText(*m_api, imagePath, options, cancel);
+	}
+
+	QImage image;
+	{
+		TRACE_SCOPE("ocr.load_image");
+		image = BufferPool::load(imagePath);
+	}
+	if (image.isNull()) {
+		return imageLoadError();
+	}
+	return recognizeCascade(image, options, cancel);
+}
+
+OcrResult OcrEngine::recognizeAnalysed() {
+	if (!m_valid) {
+		return initError();
+	}
+	return m_best && m_options.cascadeConfidence > 0
+		? recognizeLines(m_options, nullptr, true) : recognizeCurrentImage(*m_api, nullptr, true);
+}
+
+OcrResult OcrEngine::recognizeThresholded(int pageSegMode) {
+	if (!m_valid) {
+		return initError();
+	}
+	// The mode is chosen already; the analysed path keeps it
+	const tesseract::PageSegMode mode = m_api->GetPageSegMode();
+	m_api->SetPageSegMode(static_cast<tesseract::PageSegMode>(pageSegMode));
+	OcrResult result = recognizeAnalysed();
+	m_api->SetPageSegMode(mode);
+	return result;
+}
+
+OcrResult OcrEngine::recognizeCascade(const QImage& image, const OcrOptions& options, const std::atomic<bool>* cancel) {
+	if (!setImage(*m_api, image, options)) {
+		return imageLoadError();
+	}
+	return recognizeLines(options, cancel, false);
+}
+
+OcrResult OcrEngine::recognizeLines(const OcrOptions& options, const std::atomic<bool>* cancel, bool analysed) {
+	if (!::recognize(*m_api, cancel, analysed)) {
+		m_api->Clear();
+		return cancelledError();
+	}
+
+	OcrResult result;
+	result.success = true;
+	bool bestHasImage = false;
+	int imageWidth = 0;
+	int imageHeight = 0;
+	std::unique_ptr<tesseract::ResultIterator> lines(m_api->GetIterator());
+	if (lines && !lines->Empty(tesseract::RIL_TEXTLINE)) {
+		TRACE_SCOPE("ocr.cascade");
+		do {
+			// GetUTF8Text() on the page leaves a blank line between paragraphs
+			if (lines->IsAtBeginningOf(tesseract::RIL_PARA) && !result.text.isEmpty()) {
+				result.text += "\n";
+			}
+			char* text = lines->GetUTF8Text(tesseract::RIL_TEXTLINE);
+			QString line = QString::fromUtf8(text);
+			delete[] text;
+			++result.lines;
+
+			const float confidence = lines->Confidence(tesseract::RIL_TEXTLINE);
+			int left, top, right, bottom;
+			if (confidence < options.cascadeConfidence
+				&& lines->BoundingBox(tesseract::RIL_TEXTLINE, &left, &top, &right, &bottom)) {
+				if (!bestHasImage) {
+					// The image after preprocessing, so the boxes fit
+					Pix* input = m_api->GetInputImage();
+					m_best->SetImage(input);
+					m_best->SetSourceResolution(m_api->GetSourceYResolution());
+					imageWidth = pixGetWidth(input);
+					imageHeight = pixGetHeight(input);
+					bestHasImage = true;
+				}
+				// Boxes are tight around the ink; the line model wants some
+				// margin, as far as the image goes
+				const int margin = std::max(2, (bottom - top) / 4);
+				left = std::max(0, left - margin);
+				top = std::max(0, top - margin);
+				right = std::min(imageWidth, right + margin);
+				bottom = std::min(imageHeight, bottom + margin);
+				m_best->SetRectangle(left, top, right - left, bottom - top);
+				QString better;
+				if (!recognizeText(*m_best, cancel, better)) {
+					m_best->Clear();
+					m_api->Clear();
+					return cancelledError();
+				}
+				if (m_best->MeanTextConf() > confidence && !better.trimmed().isEmpty()) {
+					line = better.trimmed() + "\n";
+				}
+				++result.escalatedLines;
+			}
+			result.text += line;
+		} while (lines->Next(tesseract::RIL_TEXTLINE));
+	}
+
+	if (bestHasImage) {
+		m_best->Clear();
+	}
+	m_api->Clear();
+	return result;
+}
+
+OcrResult OcrEngine::initError() const {
+	OcrResult result;
+	result.success = false;
+	result.errorMessage =
+		"Error initializing Tesseract OCR for language: " + m_language;
+	return result;
+}
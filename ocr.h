@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QImage>
+#include <QMap>
+#include <QPoint>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+namespace tesseract {
+	class TessBaseAPI;
+}
+
+struct OcrResult {
+	QString text;
+	bool success = false;
+	QString errorMessage;
+	bool isQrCode = false;
+	QString configuration;  // What produced the result, e.g. "qr" or a --deadline pass
+	QString word;           // The word nearest the pointer, from extractTextNear()
+	int lines = 0;          // Recognized by the model cascade, see OcrOptions::cascadeConfidence
+	int escalatedLines = 0; // Of those, recognized again with the best model
+};
+
+// Engine and preprocessing settings. The defaults are Tesseract's own, which
+// are meant for scanned pages; ocr-bench --autotune searches for better ones
+// and writes them to a profile.
+struct OcrOptions {
+	int oem = 3;                    // tesseract::OcrEngineMode, 3 = default
+	int psm = 3;                    // tesseract::PageSegMode, 3 = fully automatic
+	double scale = 1.0;             // Resize factor applied before recognition
+	bool grayscale = false;
+	bool invertDark = false;        // Turn light-on-dark captures dark-on-light
+	int binarizeThreshold = 0;      // 0 leaves binarization to Tesseract
+	int cascadeConfidence = 0;      // Lines the fast model is less sure of get the best model; 0 = off
+	QMap<QString, QString> params;  // Tesseract variables, init-only ones included
+
+	bool preprocesses() const;
+};
+
+// Where ocr-bench --autotune writes its profile and the app looks for it
+QString defaultOcrProfilePath();
+
+// Missing keys keep their defaults, so a missing file yields stock settings
+OcrOptions loadOcrProfile(const QString& path);
+bool saveOcrProfile(const QString& path, const OcrOptions& options);
+
+// Initializes the engine with the options' engine mode, page segmentation
+// mode and variables. Fails for unknown variables as well as missing models.
+// An empty dataDirectory means Tesseract's own installed models.
+bool initEngine(tesseract::TessBaseAPI& ocr, const QString& language, const OcrOptions& options,
+	const QString& dataDirectory = QString());
+
+QImage preprocessForOcr(const QImage& image, const OcrOptions& options);
+
+enum class CaptureArea { Region, CurrentMonitor };
+
+bool takeScreenshot(const QString& outputPath, CaptureArea area = CaptureArea::Region);
+
+// Loads the QR plugin now rather than on the first detectQrCode(), e.g. on
+// a thread while the capture runs
+void preloadQrPlugin();
+
+OcrResult detectQrCode(const QString& imagePath);
+OcrResult detectQrCode(const QImage& image);
+
+// Initializes a fresh engine for every call
+OcrResult extractText(const QString& imagePath, const QString& language, const OcrOptions& options = {});
+
+// Reuses an engine that has already been initialized by the caller; only the
+// preprocessing part of the options applies. Setting *cancel from another
+// thread stops recognition early with an error result.
+OcrResult extractText(tesseract::TessBaseAPI& ocr, const QString& imagePath, const OcrOptions& options = {},
+	const std::atomic<bool>* cancel = nullptr);
+OcrResult extractText(tesseract::TessBaseAPI& ocr, const QImage& image, const OcrOptions& options = {},
+	const std::atomic<bool>* cancel = nullptr);
+
+// Recognizes only a small window of the image around point (in image
+// pixels) and returns the text line nearest to it, with the nearest word of
+// that line in OcrResult::word. Fails if there is no text in the window.
+OcrResult extractTextNear(tesseract::TessBaseAPI& ocr, const QString& imagePath, const QPoint& point,
+	const OcrOptions& options = {}, const std::atomic<bool>* cancel = nullptr);
+
+// An initialized engine for one language. Nothing is shared between engines,
+// so any number of them can run on different threads, but each one must
+// only be used by one thread at a time.
+//
+// With options.cascadeConfidence set and tessdata_best models installed
+// (Traineddata::bestDirectory()), a second engine is initialized with
+// those. The installed, usually integer "fast", models recognize the whole
+// image; only lines with a lower confidence are recognized again with the
+// best models, which are several times slower.
+class OcrEngine {
+public:
+	explicit OcrEngine(const QString& language, const OcrOptions& options = {},
+		const QString& dataDirectory = QString());
+	~OcrEngine();
+
+	OcrEngine(const OcrEngine&) = delete;
+	OcrEngine& operator=(const OcrEngine&) = delete;
+
+	// False if the language data is missing or the options are rejected
+	bool isValid() const { return m_valid; }
+	const QString& language() const { return m_language; }
+	const OcrOptions& options() const { return m_options; }
+
+	// Whether low-confidence lines go to a second engine
+	bool cascades() const { return m_best != nullptr; }
+
+	OcrResult recognize(const QString& imagePath);
+	OcrResult recognize(const QImage& image);
+	// With other preprocessing or cascade settings than the engine's, and
+	// cancellable as in extractText()
+	OcrResult recognize(const QString& imagePath, const OcrOptions& options, const std::atomic<bool>* cancel);
+
+	// For callers that need Tesseract beyond the text
+	tesseract::TessBaseAPI& api() { return *m_api; }
+
+	// Recognizes the image of the last AnalyseLayout() on api() with the
+	// blocks it found, instead of binarizing and analysing it again. The
+	// image must have been set without the engine's preprocessing.
+	OcrResult recognizeAnalysed();
+	// Recognizes the image set on api() with pageSegMode, a
+	// tesseract::PageSegMode, reusing the thresholded image Tesseract keeps
+	// for it. The same preprocessing condition applies.
+	OcrResult recognizeThresholded(int pageSegMode);
+
+private:
+	OcrResult initError() const;
+	OcrResult recognizeCascade(const QImage& image, const OcrOptions& options, const std::atomic<bool>* cancel);
+	// The image set on the engine, with the lines below
+	// options.cascadeConfidence recognized again by the best models
+	OcrResult recognizeLines(const OcrOptions& options, const std::atomic<bool>* cancel, bool analysed);
+
+	std::unique_ptr<tesseract::TessBaseAPI> m_api;
+	std::unique_ptr<tesseract::TessBaseAPI> m_best;
+	QString m_language;
+	OcrOptions m_options;
+	bool m_valid = false;
+};
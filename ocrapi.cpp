@@ -0,0 +1,179 @@
+#include "ocrapi.h"
+
+// qt imports
+#include <QFile>
+#include <QImage>
+#include <QString>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ocr.h"
+
+struct ocr_engine {
+	std::unique_ptr<OcrEngine> engine;
+	std::string key;
+};
+
+struct ocr_result {
+	bool success = false;
+	bool isQrCode = false;
+	std::string text;
+	std::string error;
+};
+
+namespace {
+
+	// Each engine holds its language model, so only a few are kept
+	constexpr size_t kMaxIdleEngines = 2;
+
+	struct IdleEngine {
+		std::string key;
+		std::unique_ptr<OcrEngine> engine;
+	};
+
+	std::mutex s_idleMutex;
+	std::vector<IdleEngine> s_idle;
+
+	std::unique_ptr<OcrEngine> takeIdle(const std::string& key) {
+		std::lock_guard<std::mutex> lock(s_idleMutex);
+		for (auto it = s_idle.begin(); it != s_idle.end(); ++it) {
+			if (it->key == key) {
+				std::unique_ptr<OcrEngine> engine = std::move(it->engine);
+				s_idle.erase(it);
+				return engine;
+			}
+		}
+		return nullptr;
+	}
+
+	void keepIdle(std::string key, std::unique_ptr<OcrEngine> engine) {
+		std::lock_guard<std::mutex> lock(s_idleMutex);
+		if (s_idle.size() >= kMaxIdleEngines) {
+			s_idle.erase(s_idle.begin());
+		}
+		s_idle.push_back({ std::move(key), std::move(engine) });
+	}
+
+	ocr_result* toResult(const OcrResult& source) {
+		auto* result = new ocr_result;
+		result->success = source.success;
+		result->isQrCode = source.isQrCode;
+		result->text = source.text.toStdString();
+		if (!source.success) {
+			result->error = source.errorMessage.toStdString();
+		}
+		return result;
+	}
+
+	ocr_result* errorResult(const char* message) {
+		auto* result = new ocr_result;
+		result->error = message;
+		return result;
+	}
+
+	ocr_result* recognize(ocr_engine* engine, const QImage& image, unsigned flags) {
+		if (flags & OCR_DETECT_QR) {
+			const OcrResult qr = detectQrCode(image);
+			if (qr.success) {
+				return toResult(qr);
+			}
+		}
+		return toResult(engine->engine->recognize(image));
+	}
+
+	ocr_result* recognizePixels(ocr_engine* engine, const uint8_t* pixels, int width, int height, int stride,
+		QImage::Format format, int bytesPerPixel, unsigned flags) {
+		if (!engine || !pixels || width <= 0 || height <= 0 || stride < width * bytesPerPixel) {
+			return errorResult("Invalid arguments");
+		}
+
+		// Wraps the caller's buffer; nothing is copied here
+		const QImage image(pixels, width, height, stride, format);
+		return recognize(engine, image, flags);
+	}
+
+}
+
+unsigned ocr_api_version(void) {
+	return OCR_API_VERSION;
+}
+
+ocr_engine* ocr_engine_create(const char* language, const char* profile_path) {
+	if (!language) {
+		return nullptr;
+	}
+
+	const QString profilePath = profile_path ? QString::fromUtf8(profile_path) : defaultOcrProfilePath();
+	if (profile_path && !QFile::exists(profilePath)) {
+		return nullptr;
+	}
+
+	std::string key = std::string(language) + '\n' + profilePath.toStdString();
+	std::unique_ptr<OcrEngine> engine = takeIdle(key);
+	if (!engine) {
+		engine = std::make_unique<OcrEngine>(QString::fromUtf8(language), loadOcrProfile(profilePath));
+		if (!engine->isValid()) {
+			return nullptr;
+		}
+	}
+	return new ocr_engine{ std::move(engine), std::move(key) };
+}
+
+void ocr_engine_destroy(ocr_engine* engine) {
+	if (!engine) {
+		return;
+	}
+	keepIdle(std::move(engine->key), std::move(engine->engine));
+	delete engine;
+}
+
+ocr_result* ocr_recognize_rgba(ocr_engine* engine, const uint8_t* pixels, int width, int height, int stride,
+	unsigned flags) {
+	return recognizePixels(engine, pixels, width, height, stride, QImage::Format_RGBA8888, 4, flags);
+}
+
+ocr_result* ocr_recognize_gray(ocr_engine* engine, const uint8_t* pixels, int width, int height, int stride,
+	unsigned flags) {
+	return recognizePixels(engine, pixels, width, height, stride, QImage::Format_Grayscale8, 1, flags);
+}
+
+ocr_result* ocr_recognize_file(ocr_engine* engine, const char* path, unsigned flags) {
+	if (!engine || !path) {
+		return errorResult("Invalid arguments");
+	}
+
+	const QString imagePath = QString::fromUtf8(path);
+	if (flags & OCR_DETECT_QR) {
+		const OcrResult qr = detectQrCode(imagePath);
+		if (qr.success) {
+			return toResult(qr);
+		}
+	}
+	return toResult(engine->engine->recognize(imagePath));
+}
+
+int ocr_result_success(const ocr_result* result) {
+	return result && result->success;
+}
+
+int ocr_result_is_qr_code(const ocr_result* result) {
+	return result && result->isQrCode;
+}
+
+const char* ocr_result_text(const ocr_result* result) {
+	return result ? result->text.c_str() : "";
+}
+
+size_t ocr_result_text_length(const ocr_result* result) {
+	return result ? result->text.size() : 0;
+}
+
+const char* ocr_result_error(const ocr_result* result) {
+	return result ? result->error.c_str() : "";
+}
+
+void ocr_result_free(ocr_result* result) {
+	delete result;
+}
@@ -0,0 +1,79 @@
+#ifndef SPECTACLE_OCR_API_H
+#define SPECTACLE_OCR_API_H
+
+/*
+ * C interface to the OCR core, for tools that want to recognize images in
+ * their own process instead of running spectacle-ocr-screenshot per image.
+ * Link with `pkg-config --libs spectacle-ocr`.
+ *
+ * Functions are only ever added. OCR_API_VERSION is raised when that
+ * happens, and ocr_api_version() tells which version the loaded library
+ * implements.
+ *
+ * An engine may be used from any thread, but only by one thread at a time.
+ * Separate engines can run in parallel.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OCR_API_VERSION 1
+
+/* Flags for ocr_recognize_*() */
+#define OCR_DETECT_QR 0x1u  /* Return the QR code content if there is one */
+
+typedef struct ocr_engine ocr_engine;
+typedef struct ocr_result ocr_result;
+
+unsigned ocr_api_version(void);
+
+/*
+ * Initializes an engine for language (Tesseract codes, joined with '+' for
+ * several). profile_path is a profile written by ocr-bench --autotune, or
+ * NULL for the one the app uses if it exists. Returns NULL if the language
+ * data is missing or the profile is rejected.
+ *
+ * Destroyed engines are kept for a later create with the same language and
+ * profile, so a caller that creates an engine per request only pays for
+ * initialization once.
+ */
+ocr_engine* ocr_engine_create(const char* language, const char* profile_path);
+void ocr_engine_destroy(ocr_engine* engine);
+
+/*
+ * Recognizes 8-bit RGBA pixels (R, G, B, A in memory order), stride bytes
+ * apart per row. The buffer stays owned by the caller and is not copied
+ * unless the profile asks for preprocessing; it only has to live until the
+ * call returns. Never returns NULL; check ocr_result_success().
+ */
+ocr_result* ocr_recognize_rgba(ocr_engine* engine, const uint8_t* pixels, int width, int height, int stride,
+	unsigned flags);
+
+/* The same for 8-bit grayscale pixels */
+ocr_result* ocr_recognize_gray(ocr_engine* engine, const uint8_t* pixels, int width, int height, int stride,
+	unsigned flags);
+
+/* Loads and recognizes an image file */
+ocr_result* ocr_recognize_file(ocr_engine* engine, const char* path, unsigned flags);
+
+int ocr_result_success(const ocr_result* result);
+int ocr_result_is_qr_code(const ocr_result* result);
+
+/* UTF-8, NUL-terminated, owned by the result */
+const char* ocr_result_text(const ocr_result* result);
+size_t ocr_result_text_length(const ocr_result* result);
+
+/* Empty unless the recognition failed */
+const char* ocr_result_error(const ocr_result* result);
+
+void ocr_result_free(ocr_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
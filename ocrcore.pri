@@ -0,0 +1,28 @@
+# OCR core shared by the qmake projects; CMake builds it as the ocrcore
+# library. memstats.cpp replaces the global operator new and is left to the
+# executables.
+
+SOURCES += $$PWD/bufferpool.cpp $$PWD/flightrecorder.cpp $$PWD/kernels.cpp $$PWD/ocr.cpp $$PWD/routing.cpp $$PWD/scripts.cpp $$PWD/segmentation.cpp $$PWD/startup.cpp $$PWD/stripes.cpp $$PWD/trace.cpp $$PWD/traineddata.cpp
+HEADERS += $$PWD/bufferpool.h $$PWD/flightrecorder.h $$PWD/kernels.h $$PWD/ocr.h $$PWD/routing.h $$PWD/scripts.h $$PWD/segmentation.h $$PWD/startup.h $$PWD/stripes.h $$PWD/trace.h $$PWD/traineddata.h
+
+# The CMake build loads QR decoding as a plugin; here it is built in
+SOURCES += $$PWD/qrplugin.cpp
+HEADERS += $$PWD/qrplugin.h
+DEFINES += OCR_QR_BUILTIN
+INCLUDEPATH += $$PWD
+
+# Use pkg-config to find Tesseract, Leptonica and libpng
+unix:!macx {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += tesseract lept libpng
+}
+
+# ZXing dependency - adjust paths if needed
+unix:!macx {
+    # If ZXing is installed via package manager or system-wide
+    LIBS += -lZXing
+    
+    # If custom installation, you might need to specify include and lib paths
+    # INCLUDEPATH += /usr/local/include
+    # LIBS += -L/usr/local/lib -lZXing
+}
@@ -0,0 +1,38 @@
+#include "qrplugin.h"
+
+#include <ZXing/ReadBarcode.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+	char* decode(const unsigned char* pixels, int width, int height, int bytesPerLine, int format) {
+		ZXing::ImageFormat imageFormat = ZXing::ImageFormat::Lum;
+		if (format == OCR_QR_FORMAT_BGRA) {
+			imageFormat = ZXing::ImageFormat::BGRA;
+		}
+		else if (format == OCR_QR_FORMAT_RGBA) {
+			imageFormat = ZXing::ImageFormat::RGBA;
+		}
+
+		ZXing::ReaderOptions options;
+		options.setFormats(ZXing::BarcodeFormat::QRCode);
+		options.setTryHarder(true);
+		options.setTryRotate(true);  // Try rotated images
+
+		const ZXing::ImageView imageView(pixels, width, height, imageFormat, bytesPerLine);
+		const auto result = ZXing::ReadBarcode(imageView, options);
+		if (!result.isValid()) {
+			return nullptr;
+		}
+		return strdup(result.text().c_str());
+	}
+
+	const OcrQrPlugin s_plugin = { OCR_QR_PLUGIN_VERSION, decode };
+
+}
+
+// As a module, the entry point is looked up with dlsym()
+extern "C" __attribute__((visibility("default"))) const OcrQrPlugin* spectacle_ocr_qr_plugin() {
+	return &s_plugin;
+}
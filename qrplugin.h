@@ -0,0 +1,32 @@
+#pragma once
+
+// Interface of the QR decoding plugin, which is the only code that links
+// ZXing. It is loaded on first use, so launches with --disable-qr or with a
+// --server never load ZXing at all.
+
+#define OCR_QR_PLUGIN_VERSION 1
+#define OCR_QR_PLUGIN_ENTRY "spectacle_ocr_qr_plugin"
+
+extern "C" {
+
+	// Memory layouts of the pixels handed to decode()
+	enum OcrQrFormat {
+		OCR_QR_FORMAT_LUM = 0,   // 8-bit gray
+		OCR_QR_FORMAT_BGRA = 1,  // B, G, R, A bytes: Qt's RGB32 and ARGB32 on little endian
+		OCR_QR_FORMAT_RGBA = 2,  // R, G, B, A bytes
+	};
+
+	struct OcrQrPlugin {
+		int version;
+		// Returns the content of the first QR code as malloc'ed UTF-8, or
+		// nullptr if there is none
+		char* (*decode)(const unsigned char* pixels, int width, int height, int bytesPerLine, int format);
+	};
+
+	typedef const OcrQrPlugin* (*OcrQrPluginEntry)();
+
+	// The entry point; only called directly when qrplugin.cpp is built into
+	// the program (OCR_QR_BUILTIN)
+	const OcrQrPlugin* spectacle_ocr_qr_plugin();
+
+}
@@ -0,0 +1,190 @@
+#include "refinement.h"
+
+// qt imports
+#include <QCoreApplication>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <utility>
+#include "startup.h"
+#include "stripes.h"
+#include "trace.h"
+
+namespace {
+
+	// Area the first pass is scaled down to; recognition time grows with it
+	constexpr double kFastPassPixels = 2e6;
+	// Below this, small UI text becomes unreadable
+	constexpr double kFastPassMinScale = 0.5;
+
+	void deliver(const std::function<void(const OcrResult&)>& onResult, const OcrResult& result) {
+		QMetaObject::invokeMethod(QCoreApplication::instance(), [onResult, result]() {
+			onResult(result);
+			}, Qt::QueuedConnection);
+	}
+
+}
+
+std::vector<Refinement::Pass> Refinement::passesFor(const QSize& imageSize, const OcrOptions& profile, bool qr,
+	bool quickFirst) {
+	Pass full;
+	full.name = "full";
+	full.qr = qr;
+	full.options = profile;
+	if (!quickFirst) {
+		return { full };
+	}
+
+	// Large captures already take the stripe path, which needs scale 1
+	const double pixels = static_cast<double>(imageSize.width()) * imageSize.height();
+	double downscale = 1.0;
+	if (pixels > kFastPassPixels && !Stripes::isLarge(imageSize)) {
+		downscale = std::max(std::sqrt(kFastPassPixels / pixels), kFastPassMinScale);
+	}
+
+	// Grayscale alone saves next to nothing, so a capture that is small
+	// enough already, without the best models to leave out, gets no first
+	// pass that would only recognize it twice
+	if (downscale == 1.0 && profile.cascadeConfidence <= 0) {
+		return { full };
+	}
+
+	Pass fast;
+	fast.name = "fast";
+	fast.options = profile;
+	fast.options.scale = profile.scale * downscale;
+	fast.options.grayscale = true;
+	// The installed models only, without the best ones for unsure lines
+	fast.options.cascadeConfidence = 0;
+	fast.quick = true;
+
+	return { fast, full };
+}
+
+Refinement::Pass Refinement::pointerPass(const QPoint& point, const OcrOptions& profile) {
+	Pass pass;
+	pass.name = "pointer";
+	pass.nearPoint = true;
+	pass.quick = true;
+	pass.point = point;
+	pass.options = profile;
+	return pass;
+}
+
+Refinement::Refinement(EngineFactory engine, LanguageSelector languages, const QString& imagePath,
+	std::vector<Pass> passes)
+	: m_passes(std::move(passes)), m_start(std::chrono::steady_clock::now()) {
+	m_thread = std::thread(&Refinement::run, this, std::move(engine), std::move(languages), imagePath);
+}
+
+Refinement::~Refinement() {
+	cancel();
+	m_thread.join();
+}
+
+OcrResult Refinement::waitForBest(int deadlineMs) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (deadlineMs >= 0) {
+		m_wake.wait_until(lock, m_start + std::chrono::milliseconds(deadlineMs), [this] { return m_done; });
+	}
+	else {
+		m_wake.wait(lock, [this] { return m_version > 0 || m_done; });
+	}
+	m_taken = m_version;
+	if (m_version == 0) {
+		OcrResult none;
+		none.errorMessage = m_done ? "No recognition pass finished" : "No recognition pass finished before the deadline";
+		return none;
+	}
+	return m_best;
+}
+
+void Refinement::subscribe(std::function<void(const OcrResult&)> onResult) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_onResult = std::move(onResult);
+	if (m_version > m_taken) {
+		deliver(m_onResult, m_best);
+	}
+}
+
+void Refinement::cancel() {
+	m_cancel.store(true, std::memory_order_relaxed);
+}
+
+void Refinement::run(EngineFactory makeEngine, LanguageSelector selectLanguages, QString imagePath) {
+	// Passes of the same languages share an engine
+	std::map<QString, std::unique_ptr<OcrEngine>> engines;
+	std::optional<QString> quickLanguages;
+	std::optional<QString> fullLanguages;
+	for (const Pass& pass : m_passes) {
+		if (m_cancel.load(std::memory_order_relaxed)) {
+			break;
+		}
+
+		if (pass.qr) {
+			TRACE_SCOPE("qr");
+			const OcrResult qr = detectQrCode(imagePath);
+			if (qr.success) {
+				publish(qr);
+				break;
+			}
+		}
+		if (!pass.ocr) {
+			continue;
+		}
+
+		std::optional<QString>& languages = pass.quick ? quickLanguages : fullLanguages;
+		if (!languages) {
+			languages = selectLanguages(pass.quick);
+		}
+		std::unique_ptr<OcrEngine>& engine = engines[*languages];
+		if (!engine) {
+			engine = makeEngine(*languages);
+		}
+		if (!engine->isValid()) {
+			// Reports the initialization error
+			publish(engine->recognize(imagePath));
+			break;
+		}
+
+		Trace::Span span("refine.pass");
+		span.setDetail(pass.name);
+		OcrResult result = pass.nearPoint
+			? extractTextNear(engine->api(), imagePath, pass.point, pass.options, &m_cancel)
+			: engine->recognize(imagePath, pass.options, &m_cancel);
+		span.end();
+		if (m_cancel.load(std::memory_order_relaxed)) {
+			break;
+		}
+		if (pass.nearPoint) {
+			if (!result.success) {
+				continue;
+			}
+			Startup::mark("first_word");
+		}
+		result.configuration = pass.name;
+		publish(result);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_done = true;
+	}
+	m_wake.notify_all();
+}
+
+void Refinement::publish(const OcrResult& result) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!result.success && m_best.success) {
+			return;
+		}
+		m_best = result;
+		++m_version;
+		if (m_onResult) {
+			deliver(m_onResult, result);
+		}
+	}
+	m_wake.notify_all();
+}
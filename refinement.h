@@ -0,0 +1,89 @@
+#pragma once
+
+// qt imports
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ocr.h"
+
+// Recognition against a deadline (--deadline). Passes of increasing cost
+// run one after another on a worker thread; the quick ones on an engine of
+// a single language, the others on the languages the capture needs. The
+// caller takes whatever is best when the deadline comes and may listen for
+// better results after that. Every result carries the name of the pass
+// that produced it in OcrResult::configuration.
+class Refinement {
+public:
+	struct Pass {
+		QString name;
+		bool qr = false;
+		bool ocr = true;
+		bool nearPoint = false;  // Only the line at point, see extractTextNear()
+		bool quick = false;      // Any engine of one language of the capture will do
+		QPoint point;
+		OcrOptions options;  // Only the preprocessing part applies
+	};
+
+	// Called on the worker thread, once per language
+	using EngineFactory = std::function<std::unique_ptr<OcrEngine>(const QString& language)>;
+	// The languages to recognize with: for quick passes without waiting for
+	// anything, for the others e.g. after script detection. Called on the
+	// worker thread, at most once each.
+	using LanguageSelector = std::function<QString(bool quick)>;
+
+	// With quickFirst a downscaled grayscale pass without QR detection or
+	// the best models, then the profile's settings with QR detection if
+	// enabled. A capture too small to downscale, with a profile that does
+	// not cascade, only gets the latter.
+	static std::vector<Pass> passesFor(const QSize& imageSize, const OcrOptions& profile, bool qr, bool quickFirst);
+
+	// The line under the pointer (--near-pointer), to go before the others.
+	// Marks the first_word startup milestone when it finds one; when it
+	// does not, nothing is published and the next pass is waited for.
+	static Pass pointerPass(const QPoint& point, const OcrOptions& profile);
+
+	// Starts the passes right away
+	Refinement(EngineFactory engine, LanguageSelector languages, const QString& imagePath, std::vector<Pass> passes);
+	// Cancels the running pass and waits for the worker
+	~Refinement();
+
+	Refinement(const Refinement&) = delete;
+	Refinement& operator=(const Refinement&) = delete;
+
+	// Blocks until deadlineMs after construction, or all passes are done.
+	// Later passes win unless they failed where an earlier one succeeded.
+	// Fails if no pass has finished by then. A negative deadlineMs waits
+	// for the first result instead.
+	OcrResult waitForBest(int deadlineMs);
+
+	// Calls onResult on the main thread for every better result arriving
+	// after the one waitForBest() returned
+	void subscribe(std::function<void(const OcrResult&)> onResult);
+
+	// Skips the remaining passes and stops the running one
+	void cancel();
+
+private:
+	void run(EngineFactory engine, LanguageSelector languages, QString imagePath);
+	void publish(const OcrResult& result);
+
+	std::vector<Pass> m_passes;
+	std::atomic<bool> m_cancel{ false };
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::chrono::steady_clock::time_point m_start;
+	OcrResult m_best;
+	int m_version = 0;          // Results published so far
+	int m_taken = 0;            // The version waitForBest() returned
+	bool m_done = false;
+	std::function<void(const OcrResult&)> m_onResult;
+	std::thread m_thread;
+};
@@ -0,0 +1,282 @@
+#include "routing.h"
+
+#include <leptonica/allheaders.h>
+#include <tesseract/baseapi.h>
+#include <tesseract/resultiterator.h>
+// qt imports
+#include <QMap>
+#include <QStringList>
+#include <future>
+#include <map>
+#include <memory>
+#include "bufferpool.h"
+#include "scripts.h"
+#include "segmentation.h"
+#include "trace.h"
+#include "traineddata.h"
+
+namespace Routing {
+
+	namespace {
+
+		// Block boxes are tight around the ink; recognition wants some margin
+		constexpr int kMargin = 4;
+
+		// The first of languages written in script, or empty
+		QString languageOf(const QStringList& languages, const QString& script) {
+			if (script.isEmpty()) {
+				return QString();
+			}
+			for (const QString& language : languages) {
+				if (Scripts::scriptsOf(language).contains(script)) {
+					return language;
+				}
+			}
+			return QString();
+		}
+
+		void setGray(tesseract::TessBaseAPI& api, const QImage& gray) {
+			api.SetImage(gray.constBits(), gray.width(), gray.height(), 1, static_cast<int>(gray.bytesPerLine()));
+		}
+
+		// plan() with gray, the luminance of image, already set on layout
+		std::vector<Block> planSet(const QImage& image, const QImage& gray, OcrEngine& layout,
+			Scripts::Detector* detector, const QString& languages) {
+			const QStringList parts = languages.split('+', Qt::SkipEmptyParts);
+			const QString fallback = parts.isEmpty() ? languages : parts.first();
+			const bool detectScripts = parts.size() > 1 && detector && detector->isValid();
+			std::vector<Block> blocks;
+
+			if (layout.isValid() && !gray.isNull()) {
+				tesseract::TessBaseAPI& api = layout.api();
+				std::unique_ptr<tesseract::PageIterator> page(api.AnalyseLayout());
+				if (page && !page->Empty(tesseract::RIL_BLOCK)) {
+					// Layout analysis thresholded the image already
+					Pix* binary = api.GetThresholdedImage();
+					if (detectScripts) {
+						detector->setImage(gray);
+					}
+					do {
+						int left, top, right, bottom;
+						// Pictures, rules and noise have no language
+						if (!tesseract::PTIsTextType(page->BlockType())
+							|| !page->BoundingBox(tesseract::RIL_BLOCK, &left, &top, &right, &bottom)) {
+							continue;
+						}
+						Block block;
+						block.rect = QRect(left, top, right - left, bottom - top)
+							.adjusted(-kMargin, -kMargin, kMargin, kMargin).intersected(gray.rect());
+						if (detectScripts) {
+							block.language = languageOf(parts, detector->scriptIn(block.rect));
+						}
+						block.vertical = Segmentation::isVertical(binary, left, top, right - left, bottom - top);
+						blocks.push_back(block);
+					} while (page->Next(tesseract::RIL_BLOCK));
+					if (detectScripts) {
+						detector->clear();
+					}
+					pixDestroy(&binary);
+				}
+				// The analysis stays for recognize() to reuse
+				if (!page) {
+					api.Clear();
+				}
+			}
+
+			// A short label has too little text for OSD; it most likely shares
+			// the language of the rest of the capture
+			QMap<QString, int> counts;
+			for (const Block& block : blocks) {
+				if (!block.language.isEmpty()) {
+					++counts[block.language];
+				}
+			}
+			QString common = fallback;
+			for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+				if (it.value() > counts.value(common)) {
+					common = it.key();
+				}
+			}
+			for (Block& block : blocks) {
+				if (block.language.isEmpty()) {
+					block.language = common;
+				}
+				const QString vertical = block.vertical ? verticalLanguage(block.language) : QString();
+				if (!vertical.isEmpty()) {
+					block.language = vertical;
+				}
+			}
+
+			if (blocks.empty()) {
+				Block whole;
+				whole.rect = image.rect();
+				whole.language = fallback;
+				blocks.push_back(whole);
+			}
+			return blocks;
+		}
+
+	}
+
+	QString verticalLanguage(const QString& language) {
+		if (language.isEmpty() || language.contains('+') || language.endsWith("_vert")) {
+			return QString();
+		}
+		const QString vertical = language + "_vert";
+		return Traineddata::hasLanguage(Traineddata::directory(), vertical) ? vertical : QString();
+	}
+
+	bool isWorthwhile(const QString& languages) {
+		return languages.contains('+') || !verticalLanguage(languages).isEmpty();
+	}
+
+	std::vector<Block> plan(const QImage& image, OcrEngine& layout, Scripts::Detector* detector,
+		const QString& languages) {
+		TRACE_SCOPE("routing.plan");
+		// Both layout analysis and OSD binarize luminance anyway
+		const QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+		if (layout.isValid() && !gray.isNull()) {
+			setGray(layout.api(), gray);
+		}
+		return planSet(image, gray, layout, detector, languages);
+	}
+
+	OcrResult recognize(const QImage& image, const std::vector<Block>& blocks, const EngineFor& engineFor,
+		OcrEngine* layout) {
+		QStringList languages;
+		for (const Block& block : blocks) {
+			if (!languages.contains(block.language)) {
+				languages << block.language;
+			}
+		}
+		std::map<QString, OcrEngine*> engines;
+		for (const QString& language : languages) {
+			engines[language] = engineFor(language);
+			if (!engines[language]) {
+				OcrResult result;
+				result.success = false;
+				result.errorMessage = "Error initializing Tesseract OCR for language: " + language;
+				return result;
+			}
+		}
+		// Vertical blocks are read one at a time even alone
+		const bool whole = languages.size() == 1 && !blocks.front().vertical;
+		OcrEngine* engine = engines[languages.first()];
+		if (whole && engine == layout && !layout->options().preprocesses()) {
+			return layout->recognizeAnalysed();
+		}
+		// Not kept around with the engine
+		if (layout) {
+			layout->api().Clear();
+		}
+		if (whole) {
+			return engine->recognize(image);
+		}
+
+		std::vector<OcrResult> results(blocks.size());
+		std::vector<std::future<void>> workers;
+		for (const QString& language : languages) {
+			OcrEngine* engine = engines[language];
+			workers.push_back(std::async(std::launch::async, [&image, &blocks, &results, engine, language]() {
+				Trace::Span span("routing.language");
+				span.setDetail(language);
+				for (size_t i = 0; i < blocks.size(); ++i) {
+					if (blocks[i].language == language) {
+						results[i] = engine->recognize(image.copy(blocks[i].rect));
+					}
+				}
+				}));
+		}
+		for (std::future<void>& worker : workers) {
+			worker.get();
+		}
+
+		OcrResult merged;
+		merged.success = true;
+		for (const OcrResult& result : results) {
+			if (!result.success) {
+				return result;
+			}
+			// Blocks are paragraphs apart, as in the page text
+			if (!result.text.trimmed().isEmpty()) {
+				if (!merged.text.isEmpty()) {
+					merged.text += "\n";
+				}
+				merged.text += result.text;
+			}
+			merged.lines += result.lines;
+			merged.escalatedLines += result.escalatedLines;
+		}
+		return merged;
+	}
+
+	OcrResult recognizeFile(const QString& imagePath, const QString& languages, Scripts::Detector* detector,
+		const EngineFor& engineFor, std::mutex* detectorMutex, std::vector<Block>* blocks) {
+		OcrResult result;
+		result.success = false;
+		const QString first = languages.section('+', 0, 0);
+		OcrEngine* layout = engineFor(first);
+		if (!layout) {
+			result.errorMessage = "Error initializing Tesseract OCR for language: " + first;
+			return result;
+		}
+		QImage image;
+		{
+			TRACE_SCOPE("ocr.load_image");
+			image = BufferPool::load(imagePath);
+		}
+		if (image.isNull()) {
+			result.errorMessage = "Failed to load image";
+			return result;
+		}
+
+		// The thresholded image is kept on the engine for whichever way the
+		// capture is recognized below
+		const QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+		if (layout->isValid() && !gray.isNull()) {
+			setGray(layout->api(), gray);
+		}
+
+		// A single language is only routed for its vertical model, but most
+		// captures are horizontal lines and blocks. Those go straight to
+		// the language's engine in the mode their profiles call for, without
+		// the full layout analysis; classify() says Page for vertical text.
+		if (!languages.contains('+') && layout->isValid() && !gray.isNull() && Segmentation::isEnabled()) {
+			Trace::Span span("routing.segmentation");
+			Pix* binary = layout->api().GetThresholdedImage();
+			const Segmentation::Layout kind = Segmentation::classify(binary);
+			pixDestroy(&binary);
+			span.setDetail(QString::fromLatin1(Segmentation::name(kind)));
+			span.end();
+			if (kind != Segmentation::Layout::Page) {
+				if (blocks) {
+					Block whole;
+					whole.rect = image.rect();
+					whole.language = first;
+					*blocks = { whole };
+				}
+				if (!layout->options().preprocesses()) {
+					return layout->recognizeThresholded(Segmentation::pageSegMode(kind));
+				}
+				layout->api().Clear();
+				return layout->recognize(image);
+			}
+		}
+
+		std::vector<Block> planned;
+		{
+			TRACE_SCOPE("routing.plan");
+			std::unique_lock<std::mutex> lock;
+			if (detector && detectorMutex) {
+				lock = std::unique_lock<std::mutex>(*detectorMutex);
+			}
+			planned = planSet(image, gray, *layout, detector, languages);
+		}
+		result = recognize(image, planned, engineFor, layout);
+		if (blocks) {
+			*blocks = std::move(planned);
+		}
+		return result;
+	}
+
+}
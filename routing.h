@@ -0,0 +1,73 @@
+#pragma once
+
+// qt imports
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "ocr.h"
+
+namespace Scripts {
+	class Detector;
+}
+
+// Mixed-script captures, such as English UI around Japanese text, recognized
+// block by block with single-language engines instead of one eng+jpn engine.
+// A combined engine runs every one of its models over every line; here the
+// layout is analysed once, OSD tells the script of each text block, and the
+// blocks of each language go to that language's engine, the languages in
+// parallel.
+//
+// Vertical blocks, as in manga and visual novels, go to the vertical model
+// of their language (jpn_vert) where one is installed, so even a single
+// language is worth routing then.
+namespace Routing {
+
+	struct Block {
+		QRect rect;             // In image pixels, with some margin around the ink
+		QString language;       // One of the languages passed to plan(), or its vertical model
+		bool vertical = false;  // Text running top to bottom
+	};
+
+	// The installed vertical model of language, e.g. jpn_vert for jpn, or
+	// empty if there is none
+	QString verticalLanguage(const QString& language);
+
+	// Whether capturing with languages ("eng+jpn") needs plan() at all:
+	// several of them, or one with a vertical model
+	bool isWorthwhile(const QString& languages);
+
+	// The text blocks of image in reading order, each with the language of
+	// languages ("eng+jpn") its script belongs to. Blocks OSD cannot tell go
+	// with the language most other blocks have. layout is any valid engine;
+	// only its layout analysis is used, and kept on it for recognize().
+	// detector is only needed for several languages. Never empty: without
+	// text blocks the whole image is one block of the first language.
+	std::vector<Block> plan(const QImage& image, OcrEngine& layout, Scripts::Detector* detector,
+		const QString& languages);
+
+	// The engine for one language, valid until recognize() returns, or
+	// nullptr if it cannot be initialized. Called on the calling thread only.
+	using EngineFor = std::function<OcrEngine*(const QString& language)>;
+
+	// Recognizes the blocks of each language on its engine, one thread per
+	// language, and joins the text in the blocks' order. A plan with a single
+	// horizontal language recognizes the whole image, as that engine alone
+	// would. If that engine is layout, the one plan() analysed the image on,
+	// the layout plan() found is recognized instead of analysing it again.
+	OcrResult recognize(const QImage& image, const std::vector<Block>& blocks, const EngineFor& engineFor,
+		OcrEngine* layout = nullptr);
+
+	// plan() and recognize() for an image file, with the engine of the
+	// first of languages doing the layout analysis. The capture is
+	// binarized once; for a single language, a layout that
+	// Segmentation::classify() tells apart other than Page is recognized
+	// whole on that language's engine in its mode, without plan().
+	// detectorMutex, if given, is held while plan() uses detector. The
+	// blocks go to *blocks if it is not null.
+	OcrResult recognizeFile(const QString& imagePath, const QString& languages, Scripts::Detector* detector,
+		const EngineFor& engineFor, std::mutex* detectorMutex = nullptr, std::vector<Block>* blocks = nullptr);
+
+}
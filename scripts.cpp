@@ -0,0 +1,253 @@
+#include "scripts.h"
+
+#include <tesseract/baseapi.h>
+// qt imports
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QRect>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QUrl>
+#include <algorithm>
+#include "bufferpool.h"
+#include "ocr.h"
+#include "stripes.h"
+#include "trace.h"
+
+namespace Scripts {
+
+	namespace {
+
+		// Rows per band OSD looks at, and at most this many bands
+		constexpr int kBandRows = 400;
+		constexpr int kMaxBands = 4;
+		// On OSD's own scale; below this it is guessing
+		constexpr float kMinConfidence = 1.0f;
+		constexpr qint64 kCacheSeconds = 24 * 60 * 60;
+
+		const QHash<QString, QStringList>& scriptTable() {
+			static const QHash<QString, QStringList> table = [] {
+				QHash<QString, QStringList> scripts;
+				const auto add = [&scripts](const QStringList& languages, const QStringList& names) {
+					for (const QString& language : languages) {
+						scripts[language] = names;
+					}
+				};
+				add({ "afr", "aze", "cat", "ces", "cym", "dan", "deu", "eng", "est", "eus", "fin", "fra", "gle",
+					"glg", "hrv", "hun", "ind", "isl", "ita", "lat", "lav", "lit", "mlt", "msa", "nld", "nor",
+					"pol", "por", "ron", "slk", "slv", "spa", "sqi", "swa", "swe", "tgl", "tur", "vie" }, { "Latin" });
+				add({ "bel", "bul", "kaz", "mkd", "mon", "rus", "srp", "ukr" }, { "Cyrillic" });
+				add({ "ell", "grc" }, { "Greek" });
+				add({ "ara", "fas", "urd" }, { "Arabic" });
+				add({ "heb", "yid" }, { "Hebrew" });
+				add({ "hin", "mar", "nep", "san" }, { "Devanagari" });
+				add({ "ben" }, { "Bengali" });
+				add({ "tam" }, { "Tamil" });
+				add({ "tha" }, { "Thai" });
+				add({ "kat" }, { "Georgian" });
+				add({ "hye" }, { "Armenian" });
+				// OSD reports Han text with kana as Japanese and with
+				// Hangul as Korean
+				add({ "chi_sim", "chi_tra" }, { "Han" });
+				add({ "jpn" }, { "Japanese", "Han", "Hiragana", "Katakana" });
+				add({ "kor" }, { "Korean", "Hangul" });
+				return scripts;
+			}();
+			return table;
+		}
+
+		QString cachePath() {
+			return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+				+ "/spectacle-ocr-screenshot/scripts.ini";
+		}
+
+		// Window classes may contain '/', which QSettings reads as a group
+		QString cacheGroup(const QString& windowClass) {
+			return QString::fromLatin1(QUrl::toPercentEncoding(windowClass));
+		}
+
+	}
+
+	QStringList scriptsOf(const QString& language) {
+		// Vertical models read the same script
+		QString base = language;
+		if (base.endsWith("_vert")) {
+			base.chop(5);
+		}
+		return scriptTable().value(base);
+	}
+
+	Detector::Detector() : m_api(std::make_unique<tesseract::TessBaseAPI>()) {
+		TRACE_SCOPE("scripts.init");
+		OcrOptions options;
+		options.oem = tesseract::OEM_TESSERACT_ONLY;
+		options.psm = tesseract::PSM_OSD_ONLY;
+		m_valid = initEngine(*m_api, "osd", options);
+	}
+
+	Detector::~Detector() {
+		if (m_valid) {
+			m_api->End();
+		}
+	}
+
+	QStringList Detector::detect(const QString& imagePath) {
+		if (!m_valid) {
+			return {};
+		}
+
+		TRACE_SCOPE("scripts.detect");
+		QImage image;
+		if (Stripes::isLarge(QImageReader(imagePath).size())) {
+			image = Stripes::loadGray(imagePath);
+		}
+		if (image.isNull()) {
+			image = BufferPool::load(imagePath).convertToFormat(QImage::Format_Grayscale8);
+		}
+		if (image.isNull()) {
+			return {};
+		}
+
+		setImage(image);
+		QStringList scripts;
+		const int bands = std::clamp(image.height() / kBandRows, 1, kMaxBands);
+		for (int band = 0; band < bands; ++band) {
+			const int top = image.height() * band / bands;
+			const int bottom = image.height() * (band + 1) / bands;
+			const QString script = scriptIn(QRect(0, top, image.width(), bottom - top));
+			if (!script.isEmpty() && !scripts.contains(script)) {
+				scripts << script;
+			}
+		}
+		clear();
+		return scripts;
+	}
+
+	void Detector::setImage(const QImage& image) {
+		// OSD binarizes luminance anyway
+		const QImage gray = image.format() == QImage::Format_Grayscale8
+			? image : image.convertToFormat(QImage::Format_Grayscale8);
+		m_api->SetImage(gray.constBits(), gray.width(), gray.height(), 1, static_cast<int>(gray.bytesPerLine()));
+	}
+
+	QString Detector::scriptIn(const QRect& rect) {
+		if (!m_valid) {
+			return QString();
+		}
+		m_api->SetRectangle(rect.x(), rect.y(), rect.width(), rect.height());
+		int orientation = 0;
+		float orientationConfidence = 0.0f;
+		const char* script = nullptr;
+		float scriptConfidence = 0.0f;
+		// Fails when there is too little text to tell
+		if (m_api->DetectOrientationScript(&orientation, &orientationConfidence, &script, &scriptConfidence)
+			&& script && scriptConfidence >= kMinConfidence) {
+			return QString::fromLatin1(script);
+		}
+		return QString();
+	}
+
+	void Detector::clear() {
+		m_api->Clear();
+	}
+
+	QString select(const QString& languages, const QStringList& scripts) {
+		QStringList known;
+		QStringList unknown;
+		for (const QString& language : languages.split('+', Qt::SkipEmptyParts)) {
+			const QStringList written = scriptsOf(language);
+			if (written.isEmpty()) {
+				unknown << language;
+			}
+			if (std::any_of(written.begin(), written.end(), [&scripts](const QString& script) {
+				return scripts.contains(script);
+				})) {
+				known << language;
+			}
+		}
+		if (known.isEmpty()) {
+			return languages;
+		}
+
+		// Tesseract treats the first language as the primary one
+		QStringList selected;
+		for (const QString& language : languages.split('+', Qt::SkipEmptyParts)) {
+			if (known.contains(language) || unknown.contains(language)) {
+				selected << language;
+			}
+		}
+		return selected.join('+');
+	}
+
+	std::optional<QStringList> cached(const QString& windowClass) {
+		QSettings settings(cachePath(), QSettings::IniFormat);
+		settings.beginGroup(cacheGroup(windowClass));
+		settings.beginGroup("seen");
+		const qint64 now = QDateTime::currentSecsSinceEpoch();
+		QStringList scripts;
+		for (const QString& script : settings.childKeys()) {
+			if (now - settings.value(script).toLongLong() <= kCacheSeconds) {
+				scripts << script;
+			}
+		}
+		if (scripts.isEmpty()) {
+			return std::nullopt;
+		}
+		return scripts;
+	}
+
+	void remember(const QString& windowClass, const QStringList& scripts) {
+		QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+		QSettings settings(cachePath(), QSettings::IniFormat);
+		settings.beginGroup(cacheGroup(windowClass));
+		// When each script was last seen, so the others stay known too
+		settings.beginGroup("seen");
+		const qint64 now = QDateTime::currentSecsSinceEpoch();
+		for (const QString& script : scripts) {
+			settings.setValue(script, now);
+		}
+	}
+
+	QString languagesFor(Detector& detector, const QString& imagePath, const QString& languages,
+		const QString& windowClass, bool* cacheHit) {
+		if (cacheHit) {
+			*cacheHit = false;
+		}
+		if (!languages.contains('+') || !detector.isValid()) {
+			return languages;
+		}
+
+		QStringList scripts = detector.detect(imagePath);
+		// Nothing detected says nothing about the window, and keeps every
+		// language
+		if (windowClass.isEmpty() || scripts.isEmpty()) {
+			return select(languages, scripts);
+		}
+
+		// The window's earlier scripts only ever add languages: OSD may
+		// miss a short label in one of them, but what it finds is always
+		// recognized, so the window's history cannot drop a language
+		const std::optional<QStringList> seen = cached(windowClass);
+		remember(windowClass, scripts);
+		if (seen) {
+			bool known = true;
+			for (const QString& script : scripts) {
+				known = known && seen->contains(script);
+			}
+			if (cacheHit) {
+				*cacheHit = known;
+			}
+			for (const QString& script : *seen) {
+				if (!scripts.contains(script)) {
+					scripts << script;
+				}
+			}
+		}
+		return select(languages, scripts);
+	}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// qt imports
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <optional>
+
+namespace tesseract {
+	class TessBaseAPI;
+}
+
+// Which writing systems a capture contains, so that a "just in case" --lang
+// such as eng+jpn+chi_sim is narrowed down to the languages that actually
+// appear. Every language loaded adds to recognition time. Detection is
+// Tesseract's orientation and script detection (osd.traineddata).
+namespace Scripts {
+
+	// OSD's names for the scripts a language is written in, e.g. "Latin" for
+	// deu; empty for languages not listed here
+	QStringList scriptsOf(const QString& language);
+
+	// An OSD engine. Like OcrEngine, one thread at a time.
+	class Detector {
+	public:
+		Detector();
+		~Detector();
+
+		Detector(const Detector&) = delete;
+		Detector& operator=(const Detector&) = delete;
+
+		// False if osd.traineddata is not installed
+		bool isValid() const { return m_valid; }
+
+		// Scripts OSD is confident about in any of a few horizontal bands
+		// of the image, so a line of English under Japanese counts too.
+		// Empty if nothing could be told, including for missing files.
+		QStringList detect(const QString& imagePath);
+
+		// For several rectangles of one image: setImage() once (Tesseract
+		// copies it), scriptIn() for each, then clear()
+		void setImage(const QImage& image);
+		// The script OSD is confident about in rect, or empty
+		QString scriptIn(const QRect& rect);
+		void clear();
+
+	private:
+		std::unique_ptr<tesseract::TessBaseAPI> m_api;
+		bool m_valid = false;
+	};
+
+	// The languages of e.g. "eng+jpn+chi_sim" written in one of scripts,
+	// plus those whose script is unknown, in their original order. All of
+	// them if none matches, since detection may have missed the text.
+	QString select(const QString& languages, const QStringList& scripts);
+
+	// Scripts detected in a window of this class within the last day
+	std::optional<QStringList> cached(const QString& windowClass);
+	// Adds scripts to those of the window class
+	void remember(const QString& windowClass, const QStringList& scripts);
+
+	// The languages to recognize the capture with: those of the detected
+	// scripts and of the scripts seen in windowClass (if not empty) within
+	// the last day, which the detected ones are added to. *cacheHit tells
+	// whether the window had shown every detected script before. Returns
+	// languages unchanged for a single language or an invalid detector.
+	QString languagesFor(Detector& detector, const QString& imagePath, const QString& languages,
+		const QString& windowClass, bool* cacheHit = nullptr);
+
+}
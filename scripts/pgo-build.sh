@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# Builds PGO+LTO optimized binaries and compares them with a plain release
+# build on the synthetic benchmark corpus.
+#
+# Usage: scripts/pgo-build.sh [build-dir]
+#
+# <build-dir>/baseline is a plain Release build and <build-dir>/pgo the
+# optimized one; both bench results and the comparison end up in
+# <build-dir>. The training run renders the corpus with ocr-bench and runs
+# ocr-cli over it. Extra ocr-bench arguments for the training and the
+# comparison runs can be passed through TRAIN_ARGS and BENCH_ARGS.
+set -euo pipefail
+
+src=$(cd "$(dirname "$0")/.." && pwd)
+out=$(mkdir -p "${1:-pgo-build}" && cd "${1:-pgo-build}" && pwd)
+read -r -a train_args <<< "${TRAIN_ARGS:---lang eng,deu --samples 40 --iterations 1}"
+read -r -a bench_args <<< "${BENCH_ARGS:---lang eng,deu --samples 60 --iterations 3}"
+jobs=$(nproc)
+
+configure() {
+	cmake -S "$src" -B "$1" -DCMAKE_BUILD_TYPE=Release "${@:2}" > /dev/null
+}
+
+echo "Building the baseline"
+configure "$out/baseline" -DOCR_PGO=OFF -DOCR_LTO=OFF
+cmake --build "$out/baseline" -j"$jobs" > /dev/null
+
+echo "Building instrumented binaries"
+profiles="$out/pgo/profiles"
+rm -rf "$profiles"
+configure "$out/pgo" -DOCR_PGO=GENERATE -DOCR_LTO=ON -DOCR_PGO_DIR="$profiles"
+cmake --build "$out/pgo" -j"$jobs" --clean-first > /dev/null
+
+echo "Training"
+corpus="$out/pgo/training-corpus"
+rm -rf "$corpus"
+"$out/pgo/ocr-bench" "${train_args[@]}" --corpus-dir "$corpus" -o /dev/null > /dev/null
+find "$corpus" -name '*.png' -print0 | xargs -0 "$out/pgo/ocr-cli" --json > /dev/null || true
+
+# Clang writes raw profiles that have to be merged; GCC reads its own
+if compgen -G "$profiles/*.profraw" > /dev/null; then
+	llvm-profdata merge -o "$profiles/default.profdata" "$profiles"/*.profraw
+fi
+
+echo "Building with the profiles"
+configure "$out/pgo" -DOCR_PGO=USE
+cmake --build "$out/pgo" -j"$jobs" --clean-first > /dev/null
+
+echo "Benchmarking"
+"$out/baseline/ocr-bench" "${bench_args[@]}" -o "$out/baseline.json" > /dev/null
+"$out/pgo/ocr-bench" "${bench_args[@]}" -o "$out/pgo.json" > /dev/null
+"$out/pgo/ocr-bench" --compare "$out/baseline.json" "$out/pgo.json" | tee "$out/comparison.txt" || true
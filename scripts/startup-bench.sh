@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+# Measures hotkey-to-text startup with a warm and a cold page cache.
+#
+# Usage: scripts/startup-bench.sh <spectacle-ocr-screenshot> <image> [runs] [output-dir]
+#
+# Every run appends one JSON line (see --startup-json) to warm.jsonl or
+# cold.jsonl in the output directory. Cold runs drop the page cache first,
+# which needs root (or passwordless sudo); without it, vmtouch is used to
+# evict the binary, its libraries and the traineddata instead. Extra app
+# arguments such as --lang can be passed through APP_ARGS.
+set -euo pipefail
+
+if [ $# -lt 2 ]; then
+	sed -n '4,5p' "$0" | sed 's/^# //'
+	exit 2
+fi
+
+app=$(readlink -f "$1")
+image=$(readlink -f "$2")
+[ -f "$image" ] || { echo "No such image: $2" >&2; exit 2; }
+runs=${3:-10}
+out=${4:-startup-results}
+read -r -a app_args <<< "${APP_ARGS:-}"
+
+mkdir -p "$out"
+rm -f "$out/warm.jsonl" "$out/cold.jsonl"
+
+run_once() {
+	"$app" --image "$image" --quit-after-text --startup-json "$1" "${app_args[@]}" > /dev/null
+}
+
+drop_caches() {
+	sync
+	if [ -w /proc/sys/vm/drop_caches ]; then
+		echo 3 > /proc/sys/vm/drop_caches
+	elif sudo -n true 2> /dev/null; then
+		echo 3 | sudo -n tee /proc/sys/vm/drop_caches > /dev/null
+	elif command -v vmtouch > /dev/null; then
+		local tessdata=${TESSDATA_PREFIX:-/usr/share/tessdata}
+		ldd "$app" | awk '/=> \// { print $3 }' | xargs vmtouch -qe "$app"
+		[ -d "$tessdata" ] && vmtouch -qe "$tessdata"
+	else
+		return 1
+	fi
+}
+
+# One untimed run so the warm runs really start warm
+run_once /dev/null
+for _ in $(seq "$runs"); do
+	run_once "$out/warm.jsonl"
+done
+
+if drop_caches; then
+	for _ in $(seq "$runs"); do
+		drop_caches
+		run_once "$out/cold.jsonl"
+	done
+else
+	echo "Skipping cold runs: need root, passwordless sudo or vmtouch to drop the page cache" >&2
+fi
+
+python3 - "$out" <<'PY'
+import json, pathlib, statistics, sys
+
+for mode in ("warm", "cold"):
+    path = pathlib.Path(sys.argv[1]) / f"{mode}.jsonl"
+    if not path.exists():
+        continue
+    lines = [json.loads(line) for line in path.read_text().splitlines() if line]
+    print(f"{mode} ({len(lines)} runs, median major faults "
+          f"{statistics.median(l['major_faults'] for l in lines):.0f})")
+    names = []
+    for line in lines:
+        names += [n for n in line["milestones_ms"] if n not in names]
+    for name in names:
+        values = [l["milestones_ms"][name] for l in lines if name in l["milestones_ms"]]
+        print(f"  {name:<20} median {statistics.median(values):8.1f} ms   min {min(values):8.1f} ms")
+PY
@@ -0,0 +1,361 @@
+#include "segmentation.h"
+
+#include <leptonica/allheaders.h>
+#include <tesseract/publictypes.h>
+// qt imports
+#include <QtGlobal>
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <vector>
+
+namespace Segmentation {
+
+	namespace {
+
+		// Rows with fewer ink pixels are specks
+		constexpr int kMinInk = 2;
+		// Rows that are nearly all ink are fills and rules, not text
+		constexpr double kMaxInkFraction = 0.9;
+		// Shorter runs of ink rows are rules or noise
+		constexpr int kMinLineRows = 3;
+		// Gaps between the letters of a word stay below this fraction of
+		// the line height; spaces do not
+		constexpr double kWordGap = 1.0 / 6;
+		// A word is at most this many line heights long
+		constexpr double kMaxWordLength = 6.0;
+		// Blank columns between columns of text, in line heights
+		constexpr double kColumnGap = 2.0;
+		// Lines covering less of the text's height are scattered labels
+		constexpr double kSparseCoverage = 0.25;
+		// Rows with this fraction of the densest row's ink are the body of
+		// a line; a stretch below kSplitInk between two bodies is where two
+		// lines touch
+		constexpr double kBodyInk = 0.5;
+		constexpr double kSplitInk = 0.25;
+		// How much further apart lines are than the characters in them
+		constexpr double kLineSpacing = 1.5;
+		// A single line of text is at least this many times as long as it
+		// is thick
+		constexpr double kMinElongation = 2.5;
+
+		// Rows [top, bottom)
+		struct Line {
+			int top = 0;
+			int bottom = 0;
+		};
+
+		struct Columns {
+			int left = -1;
+			int right = -1;
+			int widestGap = 0;  // Inside [left, right]
+		};
+
+		void addRows(std::vector<l_uint32>& mask, const l_uint32* data, int wordsPerLine, const Line& line) {
+			for (int y = line.top; y < line.bottom; ++y) {
+				const l_uint32* row = data + static_cast<size_t>(y) * wordsPerLine;
+				for (int i = 0; i < wordsPerLine; ++i) {
+					mask[i] |= row[i];
+				}
+			}
+		}
+
+		// The extent of the ink in a mask of rows ORed together, and the
+		// widest blank stretch inside it
+		Columns columnsOf(const std::vector<l_uint32>& mask, int width) {
+			Columns columns;
+			int gap = 0;
+			for (int x = 0; x < width; ++x) {
+				if (!(mask[x >> 5] & (0x80000000u >> (x & 31)))) {
+					++gap;
+					continue;
+				}
+				if (columns.left < 0) {
+					columns.left = x;
+				}
+				else {
+					columns.widestGap = std::max(columns.widestGap, gap);
+				}
+				columns.right = x;
+				gap = 0;
+			}
+			return columns;
+		}
+
+		// A stretch of rows or columns with ink, and how far the ink in it
+		// reaches across
+		struct Run {
+			int start = 0;
+			int end = 0;
+			int low = 0;
+			int high = 0;
+
+			int thickness() const { return end - start; }
+			int length() const { return high - low + 1; }
+		};
+
+		// ink counts per position; low and high are the ink's extent across
+		std::vector<Run> runsOf(const std::vector<int>& ink, const std::vector<int>& low, const std::vector<int>& high) {
+			std::vector<Run> runs;
+			Run run;
+			bool inRun = false;
+			for (size_t i = 0; i <= ink.size(); ++i) {
+				const bool text = i < ink.size() && ink[i] >= kMinInk;
+				if (text && !inRun) {
+					run = Run();
+					run.start = static_cast<int>(i);
+					run.low = low[i];
+					run.high = high[i];
+					inRun = true;
+				}
+				else if (text) {
+					run.low = std::min(run.low, low[i]);
+					run.high = std::max(run.high, high[i]);
+				}
+				else if (inRun) {
+					run.end = static_cast<int>(i);
+					runs.push_back(run);
+					inRun = false;
+				}
+			}
+			return runs;
+		}
+
+		template <typename Value>
+		double median(std::vector<Value> values) {
+			std::sort(values.begin(), values.end());
+			return values[values.size() / 2];
+		}
+
+		double medianGap(const std::vector<Run>& runs) {
+			std::vector<int> gaps;
+			for (size_t i = 1; i < runs.size(); ++i) {
+				gaps.push_back(runs[i].start - runs[i - 1].end);
+			}
+			return median(gaps);
+		}
+
+		double medianThickness(const std::vector<Run>& runs) {
+			std::vector<int> thicknesses;
+			for (const Run& run : runs) {
+				thicknesses.push_back(run.thickness());
+			}
+			return median(thicknesses);
+		}
+
+		// Thin strokes split a character into several runs, so only the
+		// lengths are compared across the two directions
+		double medianLength(const std::vector<Run>& runs) {
+			std::vector<int> lengths;
+			for (const Run& run : runs) {
+				lengths.push_back(run.length());
+			}
+			return median(lengths);
+		}
+
+		// Two lines whose descenders and ascenders touch form one run of
+		// ink rows, with only those between the two bodies
+		bool isTwoLines(const std::vector<int>& ink, const Line& line) {
+			const int densest = *std::max_element(ink.begin() + line.top, ink.begin() + line.bottom);
+			bool body = false;
+			bool split = false;
+			for (int y = line.top; y < line.bottom; ++y) {
+				if (ink[y] >= densest * kBodyInk) {
+					if (split) {
+						return true;
+					}
+					body = true;
+				}
+				else if (body && ink[y] < densest * kSplitInk) {
+					split = true;
+				}
+			}
+			return false;
+		}
+
+		// The layout of horizontal text on a 1-bit page
+		Layout layoutOf(Pix* page) {
+			const int width = pixGetWidth(page);
+			const int height = pixGetHeight(page);
+			const int wordsPerLine = pixGetWpl(page);
+			const l_uint32* data = pixGetData(page);
+
+			// Runs of rows with ink are text lines
+			std::vector<int> ink(height);
+			std::vector<Line> lines;
+			int top = -1;
+			for (int y = 0; y <= height; ++y) {
+				bool text = false;
+				if (y < height) {
+					const l_uint32* row = data + static_cast<size_t>(y) * wordsPerLine;
+					for (int i = 0; i < wordsPerLine; ++i) {
+						ink[y] += static_cast<int>(std::bitset<32>(row[i]).count());
+					}
+					text = ink[y] >= kMinInk && ink[y] <= width * kMaxInkFraction;
+				}
+				if (text && top < 0) {
+					top = y;
+				}
+				else if (!text && top >= 0) {
+					if (y - top >= kMinLineRows) {
+						lines.push_back({ top, y });
+					}
+					top = -1;
+				}
+			}
+			if (lines.empty()) {
+				return Layout::Page;
+			}
+
+			std::vector<int> heights;
+			int covered = 0;
+			std::vector<l_uint32> mask(wordsPerLine, 0);
+			for (const Line& line : lines) {
+				heights.push_back(line.bottom - line.top);
+				covered += line.bottom - line.top;
+				addRows(mask, data, wordsPerLine, line);
+			}
+			std::sort(heights.begin(), heights.end());
+			const int lineHeight = heights[heights.size() / 2];
+			const Columns columns = columnsOf(mask, width);
+
+			if (lines.size() == 1) {
+				if (isTwoLines(ink, lines.front())) {
+					return Layout::Block;
+				}
+				const bool word = columns.widestGap < lineHeight * kWordGap
+					&& columns.right - columns.left < lineHeight * kMaxWordLength;
+				return word ? Layout::Word : Layout::Line;
+			}
+
+			const int textHeight = lines.back().bottom - lines.front().top;
+			if (covered < textHeight * kSparseCoverage) {
+				return Layout::Sparse;
+			}
+			if (columns.widestGap > lineHeight * kColumnGap) {
+				return Layout::Page;
+			}
+			// A heading or a picture among the lines needs the layout analysis
+			const bool even = heights.front() * 2 >= lineHeight && heights.back() <= lineHeight * 2;
+			return even ? Layout::Block : Layout::Page;
+		}
+
+	}
+
+	bool isEnabled() {
+		static const bool enabled = qEnvironmentVariable("OCR_AUTO_PSM") != "0";
+		return enabled;
+	}
+
+	Layout classify(Pix* page, bool verticalModel) {
+		if (!page || pixGetDepth(page) != 1) {
+			return Layout::Page;
+		}
+		const int width = pixGetWidth(page);
+		const int height = pixGetHeight(page);
+		if (verticalModel) {
+			return isVertical(page, 0, 0, width, height) ? Layout::Vertical : Layout::Page;
+		}
+		// Rows of vertical text look like lines too; Tesseract's own
+		// analysis finds vertical blocks
+		const Layout layout = layoutOf(page);
+		return layout != Layout::Page && isVertical(page, 0, 0, width, height) ? Layout::Page : layout;
+	}
+
+	bool isVertical(Pix* page, int left, int top, int width, int height) {
+		if (!page || pixGetDepth(page) != 1) {
+			return false;
+		}
+		const int right = std::min(left + width, pixGetWidth(page));
+		const int bottom = std::min(top + height, pixGetHeight(page));
+		left = std::max(left, 0);
+		top = std::max(top, 0);
+		if (right <= left || bottom <= top) {
+			return false;
+		}
+		const int wordsPerLine = pixGetWpl(page);
+		const l_uint32* data = pixGetData(page);
+
+		// Ink per row and column, and how far it reaches the other way
+		std::vector<int> rowInk(bottom - top);
+		std::vector<int> rowLow(bottom - top, right);
+		std::vector<int> rowHigh(bottom - top, left);
+		std::vector<int> columnInk(right - left);
+		std::vector<int> columnLow(right - left, bottom);
+		std::vector<int> columnHigh(right - left, top);
+		for (int y = top; y < bottom; ++y) {
+			const l_uint32* row = data + static_cast<size_t>(y) * wordsPerLine;
+			for (int word = left >> 5; word <= (right - 1) >> 5; ++word) {
+				if (!row[word]) {
+					continue;
+				}
+				for (int x = std::max(word << 5, left); x < std::min((word + 1) << 5, right); ++x) {
+					if (row[word] & (0x80000000u >> (x & 31))) {
+						const int r = y - top;
+						const int c = x - left;
+						++rowInk[r];
+						rowLow[r] = std::min(rowLow[r], x);
+						rowHigh[r] = std::max(rowHigh[r], x);
+						++columnInk[c];
+						columnLow[c] = std::min(columnLow[c], y);
+						columnHigh[c] = std::max(columnHigh[c], y);
+					}
+				}
+			}
+		}
+
+		const std::vector<Run> rows = runsOf(rowInk, rowLow, rowHigh);
+		const std::vector<Run> columns = runsOf(columnInk, columnLow, columnHigh);
+		if (rows.empty() || columns.empty()) {
+			return false;
+		}
+		if (rows.size() >= 2 && columns.size() >= 2) {
+			// Characters set on a grid leave gaps both ways; the wider ones
+			// are between lines. Columns of a table are much wider than a
+			// character.
+			return medianGap(columns) > medianGap(rows) * kLineSpacing
+				&& medianThickness(columns) < medianThickness(rows) * 2;
+		}
+		// A single line, or lines whose characters do not line up: the
+		// runs along the lines are long, those across them a character
+		const double down = medianLength(columns);
+		return down >= medianThickness(columns) * kMinElongation && down > medianLength(rows) * kLineSpacing;
+	}
+
+	int pageSegMode(Layout layout) {
+		switch (layout) {
+		case Layout::Word:
+			return tesseract::PSM_SINGLE_WORD;
+		case Layout::Line:
+			return tesseract::PSM_SINGLE_LINE;
+		case Layout::Block:
+			return tesseract::PSM_SINGLE_BLOCK;
+		case Layout::Sparse:
+			return tesseract::PSM_SPARSE_TEXT;
+		case Layout::Vertical:
+			return tesseract::PSM_SINGLE_BLOCK_VERT_TEXT;
+		case Layout::Page:
+			break;
+		}
+		return tesseract::PSM_AUTO;
+	}
+
+	const char* name(Layout layout) {
+		switch (layout) {
+		case Layout::Word:
+			return "word";
+		case Layout::Line:
+			return "line";
+		case Layout::Block:
+			return "block";
+		case Layout::Sparse:
+			return "sparse";
+		case Layout::Vertical:
+			return "vertical";
+		case Layout::Page:
+			break;
+		}
+		return "page";
+	}
+
+}
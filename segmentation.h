@@ -0,0 +1,32 @@
+#pragma once
+
+struct Pix;
+
+// Tesseract's fully automatic page segmentation (PSM 3) looks for columns,
+// pictures and tables even when the capture is a single line, and that
+// analysis is a large part of recognizing one. This tells from projection
+// profiles of the binarized capture whether it is a word, a line, a block
+// or scattered text, for which cheaper modes do as well.
+namespace Segmentation {
+
+	enum class Layout { Word, Line, Block, Sparse, Page, Vertical };
+
+	// False with OCR_AUTO_PSM=0, which keeps PSM 3 for everything
+	bool isEnabled();
+
+	// page is 1 bit per pixel, foreground set, as Tesseract thresholds it.
+	// Page whenever the profiles are not clear, since that mode handles
+	// every layout, and for vertical text. For an engine with a vertical
+	// model (jpn_vert), Vertical if the text is, else Page.
+	Layout classify(Pix* page, bool verticalModel = false);
+
+	// Whether the text in the rectangle of page runs top to bottom, as
+	// Japanese and Chinese often do: its lines are columns, further apart
+	// than the characters in them. Too little text to tell is horizontal.
+	bool isVertical(Pix* page, int left, int top, int width, int height);
+
+	// tesseract::PageSegMode: 8, 7, 6, 11, 3 or 5
+	int pageSegMode(Layout layout);
+	const char* name(Layout layout);
+
+}
@@ -0,0 +1,654 @@
+#include "server.h"
+
+// qt imports
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <malloc.h>
+#include "bufferpool.h"
+#include "flightrecorder.h"
+#include "memstats.h"
+#include "metrics.h"
+#include "routing.h"
+#include "scripts.h"
+#include "stripes.h"
+#include "trace.h"
+
+namespace Server {
+
+	namespace {
+
+		struct Job {
+			QPointer<QLocalSocket> socket;
+			QString imagePath;
+			QString language;
+			bool qr = true;
+			bool detectScripts = false;
+			QString windowClass;
+			QElapsedTimer queued;
+		};
+
+		// Idle engines per language. An engine is handed to one worker at a
+		// time and returned after the request.
+		class EnginePool {
+		public:
+			explicit EnginePool(const OcrOptions& options) : m_options(options) {}
+
+			// Returns nullptr if the engine cannot be initialized
+			std::unique_ptr<OcrEngine> acquire(const QString& language, bool& reused) {
+				const std::string labels = Metrics::labels({ { "language", language } });
+				bool evicted = false;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					++m_uses[language];
+					evicted = m_evicted.erase(language) > 0;
+					auto& idle = m_idle[language];
+					if (!idle.empty()) {
+						auto engine = std::move(idle.back());
+						idle.pop_back();
+						reused = true;
+						Metrics::increment("ocr_engine_pool_hits_total", labels);
+						Metrics::addGauge("ocr_engine_pool_idle", -1, labels);
+						return engine;
+					}
+				}
+
+				reused = false;
+				Metrics::increment("ocr_engine_pool_misses_total", labels);
+				QElapsedTimer timer;
+				timer.start();
+				auto engine = std::make_unique<OcrEngine>(language, m_options);
+				if (!engine->isValid()) {
+					return nullptr;
+				}
+				if (evicted) {
+					// What dropping the engine while idle cost this request
+					const double seconds = timer.nsecsElapsed() / 1e9;
+					Metrics::observe("ocr_eviction_penalty_seconds", seconds, labels);
+					QTextStream(stderr) << "Reinitialized evicted " << language << " engine in "
+						<< QString::number(seconds * 1000, 'f', 0) << " ms\n";
+				}
+				Metrics::addGauge("ocr_engine_pool_size", 1, labels);
+				return engine;
+			}
+
+			void release(const QString& language, std::unique_ptr<OcrEngine> engine) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_idle[language].push_back(std::move(engine));
+				Metrics::addGauge("ocr_engine_pool_idle", 1, Metrics::labels({ { "language", language } }));
+			}
+
+			// Drops every idle engine except one of the most used language and
+			// returns how many were dropped
+			int evictCold() {
+				std::vector<std::unique_ptr<OcrEngine>> dropped;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					QString warm;
+					int warmUses = -1;
+					for (const auto& [language, idle] : m_idle) {
+						if (!idle.empty() && m_uses[language] > warmUses) {
+							warm = language;
+							warmUses = m_uses[language];
+						}
+					}
+
+					for (auto& [language, idle] : m_idle) {
+						const size_t keep = language == warm ? 1 : 0;
+						if (idle.size() <= keep) {
+							continue;
+						}
+						const std::string labels = Metrics::labels({ { "language", language } });
+						const double count = static_cast<double>(idle.size() - keep);
+						Metrics::addGauge("ocr_engine_pool_idle", -count, labels);
+						Metrics::addGauge("ocr_engine_pool_size", -count, labels);
+						while (idle.size() > keep) {
+							dropped.push_back(std::move(idle.back()));
+							idle.pop_back();
+						}
+						if (keep == 0) {
+							m_evicted.insert(language);
+						}
+					}
+				}
+				// Engines are destroyed outside the lock; End() takes a while
+				const int count = static_cast<int>(dropped.size());
+				dropped.clear();
+				return count;
+			}
+
+		private:
+			OcrOptions m_options;
+			std::mutex m_mutex;
+			std::map<QString, std::vector<std::unique_ptr<OcrEngine>>> m_idle;
+			std::map<QString, int> m_uses;
+			std::set<QString> m_evicted;
+		};
+
+		// errorMessage embeds the language; metrics need a small fixed set
+		// of label values
+		QString errorType(const QString& message) {
+			if (message.startsWith("Error initializing Tesseract")) {
+				return "engine_init";
+			}
+			if (message.startsWith("Failed to load image")) {
+				return "image_load";
+			}
+			if (message.startsWith("Bad request")) {
+				return "bad_request";
+			}
+			return "other";
+		}
+
+		void describeMetrics() {
+			const std::vector<double> latencyBuckets = { 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+			Metrics::describeCounter("ocr_captures_total", "Requests handled, by the path that produced the result.");
+			Metrics::describeCounter("ocr_qr_hits_total", "Requests answered by QR code detection.");
+			Metrics::describeHistogram("ocr_latency_seconds", "OCR time per request by language, queueing excluded.", latencyBuckets);
+			Metrics::describeHistogram("ocr_queue_wait_seconds", "Time requests spent waiting for a worker.", latencyBuckets);
+			Metrics::describeGauge("ocr_queue_depth", "Requests waiting for a worker.");
+			Metrics::describeGauge("ocr_engine_pool_size", "Initialized engines by language.");
+			Metrics::describeGauge("ocr_engine_pool_idle", "Engines not in use by language.");
+			Metrics::describeCounter("ocr_engine_pool_hits_total", "Requests served by an already initialized engine.");
+			Metrics::describeCounter("ocr_engine_pool_misses_total", "Requests that had to initialize an engine.");
+			Metrics::describeCounter("ocr_errors_total", "Failed requests by error type.");
+			Metrics::describeHistogram("ocr_script_detection_seconds",
+				"Time to find the scripts in a capture sent with several languages.", latencyBuckets);
+			Metrics::describeCounter("ocr_script_cache_hits_total",
+				"Captures whose detected scripts had all been seen in the same window class within a day.");
+			Metrics::describeCounter("ocr_routed_blocks_total",
+				"Text blocks of mixed-script captures recognized with a single-language engine, by language.");
+			Metrics::describeCounter("ocr_cascade_lines_total", "Lines recognized by engines with a model cascade.");
+			Metrics::describeCounter("ocr_cascade_escalated_lines_total",
+				"Of those, lines recognized again with the best models for low confidence.");
+			Metrics::describeCounter("ocr_buffer_pool_hits_total", "Image buffers reused from the pool.");
+			Metrics::describeCounter("ocr_buffer_pool_misses_total", "Image buffers the pool had to allocate.");
+			Metrics::describeGauge("ocr_buffer_pool_in_use_bytes", "Pooled image buffers currently in use.");
+			Metrics::describeGauge("ocr_buffer_pool_retained_bytes", "Unused image buffers kept for reuse.");
+			Metrics::describeCounter("ocr_idle_reclaims_total", "Times memory was reclaimed after a quiet period.");
+			Metrics::describeCounter("ocr_idle_engines_evicted_total", "Engines dropped after a quiet period.");
+			Metrics::describeCounter("ocr_idle_reclaimed_bytes_total", "RSS given back after quiet periods.");
+			Metrics::describeHistogram("ocr_eviction_penalty_seconds",
+				"Engine initialization paid by the first request for a language evicted while idle.", latencyBuckets);
+			Metrics::describeHistogram("ocr_first_request_after_idle_seconds",
+				"Processing time of the first request after memory was reclaimed.", latencyBuckets);
+		}
+
+		// The pool counts on its own; the counters get what it counted since
+		// the last report
+		void reportBufferPool() {
+			static std::mutex mutex;
+			static BufferPool::Stats reported;
+			std::lock_guard<std::mutex> lock(mutex);
+			const BufferPool::Stats stats = BufferPool::stats();
+			Metrics::increment("ocr_buffer_pool_hits_total", std::string(), static_cast<double>(stats.hits - reported.hits));
+			Metrics::increment("ocr_buffer_pool_misses_total", std::string(), static_cast<double>(stats.misses - reported.misses));
+			Metrics::setGauge("ocr_buffer_pool_in_use_bytes", static_cast<double>(stats.inUseBytes));
+			Metrics::setGauge("ocr_buffer_pool_retained_bytes", static_cast<double>(stats.retainedBytes));
+			reported = stats;
+		}
+
+		// Fixed set of worker threads fed from one queue
+		class Service {
+		public:
+			Service(const OcrOptions& options, int workers) : m_pool(options) {
+				m_lastActivity.start();
+				for (int i = 0; i < workers; ++i) {
+					m_threads.emplace_back([this] { work(); });
+				}
+			}
+
+			~Service() {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stopping = true;
+				}
+				m_wake.notify_all();
+				for (std::thread& thread : m_threads) {
+					thread.join();
+				}
+			}
+
+			void enqueue(Job job) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_queue.push_back(std::move(job));
+				}
+				Metrics::addGauge("ocr_queue_depth", 1);
+				m_wake.notify_one();
+			}
+
+			// Initializes one engine per language ahead of the first request,
+			// plus the vertical models of those that have one
+			void preload(QStringList languages) {
+				for (const QString& language : QStringList(languages)) {
+					for (const QString& part : language.split('+', Qt::SkipEmptyParts)) {
+						const QString vertical = Routing::verticalLanguage(part);
+						if (!vertical.isEmpty() && !languages.contains(vertical)) {
+							languages << vertical;
+						}
+					}
+				}
+				for (const QString& language : languages) {
+					bool reused = false;
+					if (auto engine = m_pool.acquire(language, reused)) {
+						m_pool.release(language, std::move(engine));
+					}
+				}
+			}
+
+			// Drops cold engines, kept buffers and free heap pages once
+			// nothing has happened for idleMs. Runs once per quiet period.
+			void reclaimIfIdle(qint64 idleMs) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_reclaimed || m_busy > 0 || !m_queue.empty() || m_lastActivity.elapsed() < idleMs) {
+						return;
+					}
+					m_reclaimed = true;
+				}
+
+				TRACE_SCOPE("server.reclaim");
+				const MemStats::Snapshot before = MemStats::snapshot();
+				const int evicted = m_pool.evictCold();
+				BufferPool::trim();
+				reportBufferPool();
+#ifdef __GLIBC__
+				::malloc_trim(0);
+#endif
+				const MemStats::Snapshot after = MemStats::snapshot();
+
+				Metrics::increment("ocr_idle_reclaims_total");
+				Metrics::increment("ocr_idle_engines_evicted_total", std::string(), evicted);
+				Metrics::increment("ocr_idle_reclaimed_bytes_total", std::string(),
+					static_cast<double>(std::max<int64_t>(0, before.rssBytes - after.rssBytes)));
+				QTextStream(stderr) << "Idle: dropped " << evicted << " engines, RSS "
+					<< QString::number(before.rssBytes / 1048576.0, 'f', 1) << " -> "
+					<< QString::number(after.rssBytes / 1048576.0, 'f', 1) << " MiB\n";
+			}
+
+		private:
+			void work() {
+				for (;;) {
+					Job job;
+					bool firstAfterIdle = false;
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+						if (m_stopping) {
+							return;
+						}
+						job = std::move(m_queue.front());
+						m_queue.pop_front();
+						++m_busy;
+						firstAfterIdle = m_reclaimed;
+						m_reclaimed = false;
+					}
+					Metrics::addGauge("ocr_queue_depth", -1);
+					Metrics::observe("ocr_queue_wait_seconds", job.queued.nsecsElapsed() / 1e9);
+
+					QElapsedTimer timer;
+					timer.start();
+					const OcrResult result = process(job);
+					if (firstAfterIdle) {
+						Metrics::observe("ocr_first_request_after_idle_seconds", timer.nsecsElapsed() / 1e9);
+					}
+					reportBufferPool();
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						--m_busy;
+						m_lastActivity.restart();
+					}
+
+					QJsonObject reply;
+					reply["success"] = result.success;
+					reply["text"] = result.text;
+					reply["error"] = result.errorMessage;
+					reply["qr"] = result.isQrCode;
+					reply["configuration"] = result.configuration;
+					const QByteArray line = QJsonDocument(reply).toJson(QJsonDocument::Compact) + "\n";
+
+					// Sockets belong to the main thread
+					QPointer<QLocalSocket> socket = job.socket;
+					QMetaObject::invokeMethod(QCoreApplication::instance(), [socket, line]() {
+						if (socket) {
+							socket->write(line);
+							socket->disconnectFromServer();
+						}
+						}, Qt::QueuedConnection);
+				}
+			}
+
+			OcrResult process(const Job& job) {
+				FlightRecorder::Capture capture(job.language);
+				const QSize imageSize = QImageReader(job.imagePath).size();
+				capture.setImageSize(imageSize.width(), imageSize.height());
+
+				OcrResult result;
+				if (job.qr) {
+					{
+						TRACE_SCOPE("qr");
+						result = detectQrCode(job.imagePath);
+					}
+					if (result.success) {
+						Metrics::increment("ocr_captures_total", Metrics::labels({ { "path", "qr" } }));
+						Metrics::increment("ocr_qr_hits_total");
+						capture.setResult(result);
+						return result;
+					}
+				}
+
+				const QString language = job.detectScripts ? selectLanguages(job) : job.language;
+				const std::string labels = Metrics::labels({ { "language", language } });
+				QElapsedTimer timer;
+				timer.start();
+				// Mixed languages need the detector for the blocks too. Large
+				// captures go through the stripe path on one engine.
+				const bool routed = language.contains('+') ? job.detectScripts && m_detector->isValid()
+					: Routing::isWorthwhile(language);
+				if (routed && !Stripes::isLarge(imageSize)) {
+					TRACE_SCOPE("ocr");
+					result = recognizeRouted(job.imagePath, language, capture);
+				}
+				else {
+					std::unique_ptr<OcrEngine> engine;
+					{
+						TRACE_SCOPE("ocr");
+						bool reused = false;
+						engine = m_pool.acquire(language, reused);
+						capture.setEngineReused(reused);
+						if (engine) {
+							result = engine->recognize(job.imagePath);
+						}
+						else {
+							result = OcrResult();
+							result.errorMessage = "Error initializing Tesseract OCR for language: " + language;
+						}
+					}
+					if (engine) {
+						m_pool.release(language, std::move(engine));
+					}
+				}
+				// The same tag the app gives its own full recognition
+				result.configuration = "full";
+				Metrics::observe("ocr_latency_seconds", timer.nsecsElapsed() / 1e9, labels);
+				if (result.lines > 0) {
+					Metrics::increment("ocr_cascade_lines_total", labels, result.lines);
+					Metrics::increment("ocr_cascade_escalated_lines_total", labels, result.escalatedLines);
+				}
+				Metrics::increment("ocr_captures_total", Metrics::labels({ { "path", "ocr" } }));
+				if (!result.success) {
+					Metrics::increment("ocr_errors_total", Metrics::labels({ { "type", errorType(result.errorMessage) } }));
+				}
+				capture.setResult(result);
+				return result;
+			}
+
+			// The languages of the job whose scripts are in the image. One
+			// detector serves all workers; OSD takes milliseconds.
+			QString selectLanguages(const Job& job) {
+				std::lock_guard<std::mutex> lock(m_detectorMutex);
+				if (!m_detector) {
+					m_detector = std::make_unique<Scripts::Detector>();
+				}
+				QElapsedTimer timer;
+				timer.start();
+				bool cacheHit = false;
+				const QString languages = Scripts::languagesFor(*m_detector, job.imagePath, job.language, job.windowClass, &cacheHit);
+				if (m_detector->isValid()) {
+					Metrics::observe("ocr_script_detection_seconds", timer.nsecsElapsed() / 1e9);
+				}
+				if (cacheHit) {
+					Metrics::increment("ocr_script_cache_hits_total");
+				}
+				return languages;
+			}
+
+			// Languages still mixed after detection, or with a vertical model:
+			// every text block goes to a pooled engine of its own language.
+			// Only planning needs the shared detector, and only for several
+			// languages.
+			OcrResult recognizeRouted(const QString& imagePath, const QString& languages, FlightRecorder::Capture& capture) {
+				std::map<QString, std::unique_ptr<OcrEngine>> engines;
+				bool allReused = true;
+				const auto engineFor = [this, &engines, &allReused](const QString& language) {
+					std::unique_ptr<OcrEngine>& engine = engines[language];
+					if (!engine) {
+						bool reused = false;
+						engine = m_pool.acquire(language, reused);
+						allReused = allReused && reused;
+					}
+					return engine.get();
+				};
+
+				std::vector<Routing::Block> blocks;
+				const OcrResult result = Routing::recognizeFile(imagePath, languages,
+					languages.contains('+') ? m_detector.get() : nullptr, engineFor, &m_detectorMutex, &blocks);
+				for (const Routing::Block& block : blocks) {
+					Metrics::increment("ocr_routed_blocks_total", Metrics::labels({ { "language", block.language } }));
+				}
+				capture.setEngineReused(allReused);
+
+				for (auto& [language, engine] : engines) {
+					if (engine) {
+						m_pool.release(language, std::move(engine));
+					}
+				}
+				return result;
+			}
+
+			EnginePool m_pool;
+			std::mutex m_detectorMutex;
+			std::unique_ptr<Scripts::Detector> m_detector;
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::deque<Job> m_queue;
+			bool m_stopping = false;
+			int m_busy = 0;
+			QElapsedTimer m_lastActivity;
+			bool m_reclaimed = false;
+			std::vector<std::thread> m_threads;
+		};
+
+	}
+
+	QString socketPath() {
+		QString directory = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+		if (directory.isEmpty()) {
+			directory = QDir::tempPath();
+		}
+		return directory + "/spectacle-ocr-screenshot.sock";
+	}
+
+	int run(int argc, char* argv[]) {
+		QCoreApplication app(argc, argv);
+		QTextStream err(stderr);
+
+		QCommandLineParser parser;
+		parser.setApplicationDescription("Resident OCR service for spectacle-ocr-screenshot");
+		parser.addHelpOption();
+
+		QCommandLineOption serverOption(
+			QStringList() << "server",
+			"Run as the resident OCR service.");
+
+		QCommandLineOption langOption(
+			QStringList() << "lang",
+			"Comma-separated languages to initialize engines for at startup.",
+			"languages", "eng");
+
+		QCommandLineOption workersOption(
+			QStringList() << "workers",
+			"Number of worker threads.",
+			"n", "2");
+
+		QCommandLineOption profileOption(
+			QStringList() << "profile",
+			"Engine settings written by ocr-bench --autotune (default: " + defaultOcrProfilePath() + " if it exists).",
+			"file");
+
+		QCommandLineOption idleOption(
+			QStringList() << "idle-timeout",
+			"Seconds without requests after which engines other than the most used one are dropped and "
+			"unused memory is returned to the system (0 to never).",
+			"seconds", "300");
+
+		QCommandLineOption metricsPortOption(
+			QStringList() << "metrics-port",
+			"Serve Prometheus metrics at http://127.0.0.1:<port>/metrics.",
+			"port");
+
+		QCommandLineOption metricsFileOption(
+			QStringList() << "metrics-file",
+			"Rewrite Prometheus metrics to <file> periodically, for the node exporter's textfile collector.",
+			"file");
+
+		QCommandLineOption metricsIntervalOption(
+			QStringList() << "metrics-interval",
+			"Seconds between --metrics-file rewrites.",
+			"seconds", "15");
+
+		parser.addOption(serverOption);
+		parser.addOption(langOption);
+		parser.addOption(workersOption);
+		parser.addOption(profileOption);
+		parser.addOption(idleOption);
+		parser.addOption(metricsPortOption);
+		parser.addOption(metricsFileOption);
+		parser.addOption(metricsIntervalOption);
+		parser.process(app);
+
+		// A stale socket is removed, a live one means a service is running
+		QLocalSocket probe;
+		probe.connectToServer(socketPath());
+		if (probe.waitForConnected(100)) {
+			err << "A service is already listening on " << socketPath() << "\n";
+			return 1;
+		}
+		QLocalServer::removeServer(socketPath());
+
+		describeMetrics();
+		if (parser.isSet(metricsPortOption)
+			&& !Metrics::serveOnLoopback(static_cast<quint16>(parser.value(metricsPortOption).toUInt()), &app)) {
+			err << "Failed to listen on 127.0.0.1:" << parser.value(metricsPortOption) << "\n";
+			return 1;
+		}
+		if (parser.isSet(metricsFileOption)) {
+			Metrics::writeFilePeriodically(parser.value(metricsFileOption),
+				std::max(1, parser.value(metricsIntervalOption).toInt()) * 1000, &app);
+		}
+
+		FlightRecorder::open();
+		FlightRecorder::installDumpSignal();
+
+		const QString profilePath = parser.isSet(profileOption) ? parser.value(profileOption) : defaultOcrProfilePath();
+		BufferPool::installForLeptonica();
+		Service service(loadOcrProfile(profilePath), std::max(1, parser.value(workersOption).toInt()));
+		service.preload(parser.value(langOption).split(',', Qt::SkipEmptyParts));
+		preloadQrPlugin();
+
+		const qint64 idleMs = std::max(0, parser.value(idleOption).toInt()) * qint64(1000);
+		QTimer idleTimer;
+		if (idleMs > 0) {
+			QObject::connect(&idleTimer, &QTimer::timeout, [&service, idleMs]() {
+				service.reclaimIfIdle(idleMs);
+				});
+			idleTimer.start(static_cast<int>(std::min<qint64>(idleMs / 4, 30000)));
+		}
+
+		QLocalServer server;
+		server.setSocketOptions(QLocalServer::UserAccessOption);
+		if (!server.listen(socketPath())) {
+			err << "Failed to listen on " << socketPath() << ": " << server.errorString() << "\n";
+			return 1;
+		}
+
+		QObject::connect(&server, &QLocalServer::newConnection, [&]() {
+			while (QLocalSocket* socket = server.nextPendingConnection()) {
+				QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+				QObject::connect(socket, &QLocalSocket::readyRead, [socket, &service]() {
+					if (!socket->canReadLine()) {
+						return;
+					}
+					const QJsonObject request = QJsonDocument::fromJson(socket->readLine()).object();
+					if (!request.contains("image") || !request.contains("language")) {
+						Metrics::increment("ocr_errors_total", Metrics::labels({ { "type", "bad_request" } }));
+						socket->write("{\"success\":false,\"error\":\"Bad request\"}\n");
+						socket->disconnectFromServer();
+						return;
+					}
+
+					Job job;
+					job.socket = socket;
+					job.imagePath = request["image"].toString();
+					job.language = request["language"].toString();
+					job.qr = request["qr"].toBool(true);
+					job.detectScripts = request["detect_scripts"].toBool(false);
+					job.windowClass = request["window_class"].toString();
+					job.queued.start();
+					service.enqueue(std::move(job));
+					});
+			}
+			});
+
+		err << "Listening on " << socketPath() << "\n";
+		return app.exec();
+	}
+
+	bool recognize(const QString& imagePath, const QString& language, bool qr, OcrResult& result,
+		bool detectScripts, const QString& windowClass) {
+		TRACE_SCOPE("server.request");
+		QLocalSocket socket;
+		socket.connectToServer(socketPath());
+		if (!socket.waitForConnected(50)) {
+			return false;
+		}
+
+		QJsonObject request;
+		request["image"] = imagePath;
+		request["language"] = language;
+		request["qr"] = qr;
+		request["detect_scripts"] = detectScripts;
+		request["window_class"] = windowClass;
+		socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+
+		// A service that goes away mid-request counts as no service
+		while (!socket.canReadLine()) {
+			if (!socket.waitForReadyRead(60000)) {
+				return false;
+			}
+		}
+		const QJsonObject reply = QJsonDocument::fromJson(socket.readLine()).object();
+		if (reply.isEmpty()) {
+			return false;
+		}
+
+		result = OcrResult();
+		result.success = reply["success"].toBool();
+		result.text = reply["text"].toString();
+		result.errorMessage = reply["error"].toString();
+		result.isQrCode = reply["qr"].toBool();
+		result.configuration = reply["configuration"].toString();
+		return true;
+	}
+
+}
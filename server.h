@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QString>
+#include "ocr.h"
+
+// Resident OCR service (--server). It keeps warm engines per language and
+// serves short-lived app instances over a local socket, so a capture does
+// not pay for engine initialization. Requests and replies are one JSON
+// object per line.
+namespace Server {
+
+	QString socketPath();
+
+	// Runs the service until it is terminated; parses its own command line
+	int run(int argc, char* argv[]);
+
+	// Has a running service try QR detection (if qr is set) and then OCR on
+	// the image. With detectScripts, only the languages whose scripts it
+	// finds are used, cached per windowClass (see Scripts). Returns false
+	// right away if no service is listening, so the caller can do the work
+	// itself.
+	bool recognize(const QString& imagePath, const QString& language, bool qr, OcrResult& result,
+		bool detectScripts = false, const QString& windowClass = QString());
+
+}
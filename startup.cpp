@@ -0,0 +1,205 @@
+#include "startup.h"
+
+#include <QEvent>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Startup {
+
+	namespace {
+
+		struct Milestone {
+			const char* name;
+			int64_t bootNs;
+		};
+
+		// Engines are constructed on several preload threads at once, so
+		// marks race with each other and with the main thread
+		std::mutex s_mutex;
+		std::array<Milestone, 32> s_milestones;
+		int s_count = 0;
+
+		std::vector<Milestone> recorded() {
+			std::lock_guard<std::mutex> lock(s_mutex);
+			return std::vector<Milestone>(s_milestones.begin(), s_milestones.begin() + s_count);
+		}
+
+		// CLOCK_BOOTTIME shares its origin with the start time in /proc/self/stat
+		int64_t bootTimeNs() {
+			timespec ts;
+			::clock_gettime(CLOCK_BOOTTIME, &ts);
+			return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+		}
+
+		struct ProcStat {
+			int64_t startNs = -1;
+			long long minorFaults = 0;
+			long long majorFaults = 0;
+		};
+
+		ProcStat readProcStat() {
+			ProcStat stat;
+			char buffer[1024];
+			const int fd = ::open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				return stat;
+			}
+			const ssize_t length = ::read(fd, buffer, sizeof(buffer) - 1);
+			::close(fd);
+			if (length <= 0) {
+				return stat;
+			}
+			buffer[length] = '\0';
+
+			// The command name is in parentheses and may contain spaces, so
+			// fields are counted from the last ')', which ends field 2. Fields
+			// 10 and 12 are minflt and majflt, 22 is starttime in clock ticks.
+			const char* fields = std::strrchr(buffer, ')');
+			unsigned long long minorFaults = 0;
+			unsigned long long majorFaults = 0;
+			unsigned long long startTicks = 0;
+			if (!fields || std::sscanf(fields + 1,
+				" %*c %*d %*d %*d %*d %*d %*u %llu %*u %llu %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu",
+				&minorFaults, &majorFaults, &startTicks) != 3) {
+				return stat;
+			}
+
+			stat.minorFaults = static_cast<long long>(minorFaults);
+			stat.majorFaults = static_cast<long long>(majorFaults);
+			const long ticks = ::sysconf(_SC_CLK_TCK);
+			if (ticks > 0) {
+				stat.startNs = static_cast<int64_t>(startTicks * (1000000000ULL / ticks));
+			}
+			return stat;
+		}
+
+		double toMs(int64_t ns) {
+			return ns / 1e6;
+		}
+
+		class FirstPaintFilter : public QObject {
+		public:
+			FirstPaintFilter(QObject* target, const char* name, std::function<void()> done)
+				: QObject(target), m_name(name), m_done(std::move(done)) {
+			}
+
+			bool eventFilter(QObject* watched, QEvent* event) override {
+				if (event->type() == QEvent::Paint) {
+					watched->removeEventFilter(this);
+					// The backing store is flushed after the paint event returns
+					QTimer::singleShot(0, [name = m_name, done = std::move(m_done)]() {
+						mark(name);
+						if (done) {
+							done();
+						}
+						});
+					deleteLater();
+				}
+				return false;
+			}
+
+		private:
+			const char* m_name;
+			std::function<void()> m_done;
+		};
+
+		// Shared library constructors have all run by the time the
+		// executable's own static initializers start
+		__attribute__((constructor(101))) void markLibrariesLoaded() {
+			mark("libraries_loaded");
+		}
+
+	}
+
+	void mark(const char* name) {
+		const int64_t now = bootTimeNs();
+		std::lock_guard<std::mutex> lock(s_mutex);
+		for (int i = 0; i < s_count; ++i) {
+			if (std::strcmp(s_milestones[i].name, name) == 0) {
+				return;
+			}
+		}
+		if (s_count < static_cast<int>(s_milestones.size())) {
+			s_milestones[s_count++] = { name, now };
+		}
+	}
+
+	void markOnFirstPaint(QObject* target, const char* name, std::function<void()> done) {
+		target->installEventFilter(new FirstPaintFilter(target, name, std::move(done)));
+	}
+
+	void printReport(QTextStream& out) {
+		const ProcStat stat = readProcStat();
+		const std::vector<Milestone> milestones = recorded();
+
+		out << QString("%1 %2 %3\n").arg("Milestone", -20).arg("since start", 12).arg("step", 10);
+		int64_t previous = stat.startNs;
+		for (const Milestone& milestone : milestones) {
+			out << QString("%1 %2 %3\n")
+				.arg(milestone.name, -20)
+				.arg(stat.startNs < 0 ? QString("?") : QString::number(toMs(milestone.bootNs - stat.startNs), 'f', 1) + " ms", 12)
+				.arg(previous < 0 ? QString("?") : QString::number(toMs(milestone.bootNs - previous), 'f', 1) + " ms", 10);
+			previous = milestone.bootNs;
+		}
+		// Major faults are pages read from disk; a warm page cache keeps them near zero
+		out << "Page faults: " << stat.majorFaults << " major, " << stat.minorFaults << " minor\n";
+	}
+
+	bool appendJson(const QString& path) {
+		const ProcStat stat = readProcStat();
+
+		QJsonObject milestones;
+		for (const Milestone& milestone : recorded()) {
+			if (stat.startNs >= 0) {
+				milestones[milestone.name] = toMs(milestone.bootNs - stat.startNs);
+			}
+		}
+
+		QJsonObject line;
+		line["milestones_ms"] = milestones;
+		line["major_faults"] = stat.majorFaults;
+		line["minor_faults"] = stat.minorFaults;
+
+		QFile file(path);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+			return false;
+		}
+		file.write(QJsonDocument(line).toJson(QJsonDocument::Compact) + "\n");
+		return true;
+	}
+
+	Session::Session(bool printReport, const QString& jsonPath)
+		: m_print(printReport), m_jsonPath(jsonPath) {
+	}
+
+	Session::~Session() {
+		report();
+	}
+
+	void Session::report() {
+		if (m_reported || !isActive()) {
+			return;
+		}
+		m_reported = true;
+		if (m_print) {
+			QTextStream err(stderr);
+			printReport(err);
+		}
+		if (!m_jsonPath.isEmpty() && !appendJson(m_jsonPath)) {
+			QTextStream(stderr) << "Failed to write startup report to " << m_jsonPath << "\n";
+		}
+	}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTextStream>
+#include <cstdint>
+#include <functional>
+
+// Startup milestones timed from process creation, so the dynamic loading of
+// Qt, Tesseract, Leptonica and ZXing before main() is part of the numbers.
+// Marks are always recorded (one clock read each) and only reported on request.
+namespace Startup {
+
+	// Records the first occurrence of a milestone; repeated marks are ignored
+	void mark(const char* name);
+
+	// Marks a milestone once the first paint of target has been flushed to
+	// the screen and calls done afterwards
+	void markOnFirstPaint(QObject* target, const char* name, std::function<void()> done = {});
+
+	// Times are from the kernel's process start time, which has clock-tick
+	// (usually 10 ms) resolution; the steps between later milestones do not
+	void printReport(QTextStream& out);
+
+	// Appends the milestones and page fault counts as one JSON line, so
+	// repeated runs can accumulate in a single file
+	bool appendJson(const QString& path);
+
+	// Reports once, either explicitly when the first text is on screen or
+	// when it goes out of scope
+	class Session {
+	public:
+		Session(bool printReport, const QString& jsonPath);
+		~Session();
+
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+
+		bool isActive() const { return m_print || !m_jsonPath.isEmpty(); }
+		void report();
+
+	private:
+		bool m_print;
+		QString m_jsonPath;
+		bool m_reported = false;
+	};
+
+}
@@ -0,0 +1,286 @@
+#include "stripes.h"
+
+#include <leptonica/allheaders.h>
+#include <png.h>
+// qt imports
+#include <QFile>
+#include <QtGlobal>
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include "bufferpool.h"
+#include "ocr.h"
+#include "trace.h"
+
+namespace Stripes {
+
+	namespace {
+
+		// Rows decoded at a time; the only full-width buffer besides the
+		// 8- or 1-bit result
+		constexpr int kStripeRows = 256;
+		// Columns of a stripe binarized with one threshold and polarity.
+		// Narrower than any monitor, so a dark terminal on one of several
+		// monitors side by side is flipped without the others. A tile
+		// across the edge of a dark window takes the polarity of the larger
+		// part; text in the smaller part is lost. A multiple of 32, so
+		// tiles start on a word of the 1-bit page.
+		constexpr int kTileColumns = 512;
+
+		// Rows of a large capture recognized at a time. Bands end on a blank
+		// row near this height, so no text line is cut in two.
+		constexpr int kBandRows = 2048;
+		constexpr int kBandSlack = 512;
+
+		struct Header {
+			int width = 0;
+			int height = 0;
+			int dotsPerMeter = 0;
+		};
+
+		using StartFunction = std::function<bool(const Header& header)>;
+		// rows holds count rows of width luminance bytes, starting at top
+		using StripeFunction = std::function<bool(const uint8_t* rows, int top, int count)>;
+
+		// Failures fall back to the regular path, so they are not printed
+		void ignoreError(png_structp png, png_const_charp) {
+			png_longjmp(png, 1);
+		}
+
+		void ignoreWarning(png_structp, png_const_charp) {}
+
+		// Streams a non-interlaced PNG as 8-bit luminance with qGray()'s
+		// weights. libpng reports errors with longjmp, so nothing in here
+		// may need a destructor.
+		bool streamGray(const QString& path, const StartFunction& start, const StripeFunction& stripe) {
+			FILE* file = std::fopen(QFile::encodeName(path).constData(), "rb");
+			if (!file) {
+				return false;
+			}
+			png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, ignoreError, ignoreWarning);
+			png_infop info = png ? png_create_info_struct(png) : nullptr;
+			uint8_t* volatile buffer = nullptr;
+
+			if (!png || !info || setjmp(png_jmpbuf(png))) {
+				png_destroy_read_struct(png ? &png : nullptr, info ? &info : nullptr, nullptr);
+				BufferPool::release(buffer);
+				std::fclose(file);
+				return false;
+			}
+
+			png_init_io(png, file);
+			png_read_info(png, info);
+			if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE) {
+				// Interlaced rows only come out complete after the last pass
+				png_error(png, "interlaced");
+			}
+
+			png_set_expand(png);
+			png_set_strip_16(png);
+			png_set_strip_alpha(png);
+			if (png_get_color_type(png, info) & PNG_COLOR_MASK_COLOR) {
+				// Red 11/32 and green 16/32 in units of 1/100000, like qGray()
+				png_set_rgb_to_gray_fixed(png, 1, 34375, 50000);
+			}
+			png_read_update_info(png, info);
+
+			Header header;
+			header.width = static_cast<int>(png_get_image_width(png, info));
+			header.height = static_cast<int>(png_get_image_height(png, info));
+			png_uint_32 resolutionX = 0;
+			png_uint_32 resolutionY = 0;
+			int unit = PNG_RESOLUTION_UNKNOWN;
+			if (png_get_pHYs(png, info, &resolutionX, &resolutionY, &unit) && unit == PNG_RESOLUTION_METER) {
+				header.dotsPerMeter = static_cast<int>(resolutionX);
+			}
+			if (png_get_rowbytes(png, info) != static_cast<size_t>(header.width) || !start(header)) {
+				png_error(png, "unsupported");
+			}
+
+			buffer = static_cast<uint8_t*>(BufferPool::allocate(static_cast<size_t>(header.width) * kStripeRows));
+			if (!buffer) {
+				png_error(png, "out of memory");
+			}
+			png_bytep rows[kStripeRows];
+			for (int i = 0; i < kStripeRows; ++i) {
+				rows[i] = buffer + static_cast<size_t>(i) * header.width;
+			}
+			for (int top = 0; top < header.height; top += kStripeRows) {
+				const int count = std::min(kStripeRows, header.height - top);
+				png_read_rows(png, rows, nullptr, static_cast<png_uint_32>(count));
+				if (!stripe(buffer, top, count)) {
+					png_error(png, "stopped");
+				}
+			}
+
+			png_destroy_read_struct(&png, &info, nullptr);
+			BufferPool::release(buffer);
+			std::fclose(file);
+			return true;
+		}
+
+		// Otsu's method: the threshold that best separates the histogram
+		// into two classes. Values at or above it are the brighter class.
+		int otsuThreshold(const uint64_t (&histogram)[256]) {
+			uint64_t total = 0;
+			double sumAll = 0.0;
+			for (int value = 0; value < 256; ++value) {
+				total += histogram[value];
+				sumAll += static_cast<double>(value) * histogram[value];
+			}
+
+			uint64_t below = 0;
+			double sumBelow = 0.0;
+			double best = -1.0;
+			int threshold = 128;
+			for (int value = 0; value < 255; ++value) {
+				below += histogram[value];
+				sumBelow += static_cast<double>(value) * histogram[value];
+				const uint64_t above = total - below;
+				if (below == 0) {
+					continue;
+				}
+				if (above == 0) {
+					break;
+				}
+				const double difference = sumBelow / below - (sumAll - sumBelow) / above;
+				const double between = static_cast<double>(below) * above * difference * difference;
+				if (between > best) {
+					best = between;
+					threshold = value + 1;
+				}
+			}
+			return threshold;
+		}
+
+		bool isBlankRow(const l_uint32* line, int words) {
+			for (int i = 0; i < words; ++i) {
+				if (line[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+	}
+
+	bool isLarge(const QSize& size) {
+		static const qint64 minPixels = [] {
+			bool ok = false;
+			const int megapixels = qEnvironmentVariableIntValue("OCR_STRIPE_MIN_MEGAPIXELS", &ok);
+			return static_cast<qint64>(ok && megapixels > 0 ? megapixels : 24) * 1000000;
+		}();
+		return size.isValid() && static_cast<qint64>(size.width()) * size.height() >= minPixels;
+	}
+
+	QImage loadGray(const QString& path) {
+		TRACE_SCOPE("stripes.load_gray");
+		QImage image;
+		const bool ok = streamGray(path,
+			[&image](const Header& header) {
+				image = BufferPool::image(QSize(header.width, header.height), QImage::Format_Grayscale8);
+				image.setDotsPerMeterX(header.dotsPerMeter);
+				image.setDotsPerMeterY(header.dotsPerMeter);
+				return !image.isNull();
+			},
+			[&image](const uint8_t* rows, int top, int count) {
+				for (int i = 0; i < count; ++i) {
+					std::memcpy(image.scanLine(top + i), rows + static_cast<size_t>(i) * image.width(), image.width());
+				}
+				return true;
+			});
+		return ok ? image : QImage();
+	}
+
+	Pix* loadBinary(const QString& path, const OcrOptions& options) {
+		TRACE_SCOPE("stripes.load_binary");
+		Pix* page = nullptr;
+		int width = 0;
+
+		const bool ok = streamGray(path,
+			[&page, &width](const Header& header) {
+				page = pixCreate(header.width, header.height, 1);
+				if (page && header.dotsPerMeter > 0) {
+					const int dpi = qRound(header.dotsPerMeter * 0.0254);
+					pixSetResolution(page, dpi, dpi);
+				}
+				width = header.width;
+				return page != nullptr;
+			},
+			[&](const uint8_t* rows, int top, int count) {
+				l_uint32* data = pixGetData(page);
+				const int wordsPerLine = pixGetWpl(page);
+				for (int left = 0; left < width; left += kTileColumns) {
+					const int right = std::min(left + kTileColumns, width);
+					uint64_t histogram[256] = {};
+					for (int i = 0; i < count; ++i) {
+						const uint8_t* row = rows + static_cast<size_t>(i) * width;
+						for (int x = left; x < right; ++x) {
+							++histogram[row[x]];
+						}
+					}
+					const int threshold = options.binarizeThreshold > 0
+						? qBound(0, options.binarizeThreshold, 255) : otsuThreshold(histogram);
+					// Tesseract wants dark text on light background; a dark
+					// tile is flipped on its own
+					uint64_t sum = 0;
+					for (int value = 0; value < 256; ++value) {
+						sum += histogram[value] * value;
+					}
+					const bool dark = sum < 128 * static_cast<uint64_t>(right - left) * count;
+
+					for (int i = 0; i < count; ++i) {
+						const uint8_t* row = rows + static_cast<size_t>(i) * width;
+						l_uint32* line = data + static_cast<size_t>(top + i) * wordsPerLine;
+						for (int x = left; x < right; ++x) {
+							if ((row[x] >= threshold) == dark) {
+								line[x >> 5] |= 0x80000000u >> (x & 31);
+							}
+						}
+					}
+				}
+				return true;
+			});
+
+		if (!ok) {
+			pixDestroy(&page);
+			return nullptr;
+		}
+		return page;
+	}
+
+	std::vector<int> bandEnds(Pix* page) {
+		const int height = pixGetHeight(page);
+		const int wordsPerLine = pixGetWpl(page);
+		const l_uint32* data = pixGetData(page);
+		const auto blank = [&](int y) { return isBlankRow(data + static_cast<size_t>(y) * wordsPerLine, wordsPerLine); };
+
+		std::vector<int> ends;
+		int top = 0;
+		while (top < height) {
+			const int target = top + kBandRows;
+			int end = std::min(target, height);
+			if (target < height) {
+				// The nearest blank row above the target, else below it
+				int y = target;
+				while (y > target - kBandSlack && !blank(y)) {
+					--y;
+				}
+				if (y == target - kBandSlack) {
+					y = target;
+					while (y < std::min(height, target + kBandSlack) && !blank(y)) {
+						++y;
+					}
+				}
+				end = y;
+			}
+			ends.push_back(end);
+			top = end;
+		}
+		return ends;
+	}
+
+}
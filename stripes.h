@@ -0,0 +1,40 @@
+#pragma once
+
+// qt imports
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <vector>
+
+struct Pix;
+struct OcrOptions;
+
+// Multi-monitor and scrolling captures can reach 60 megapixels, where an
+// RGB32 image, its Pix copy and Tesseract's own copies add up to gigabytes.
+// These decode a PNG a stripe of rows at a time instead, so the full-color
+// image never exists, and keep only 8-bit or 1-bit results of the whole
+// page. Anything else (other formats, interlaced PNGs) is left to the
+// regular path.
+namespace Stripes {
+
+	// Whether a capture of this size should go through the stripe path;
+	// OCR_STRIPE_MIN_MEGAPIXELS (default 24) sets the threshold
+	bool isLarge(const QSize& size);
+
+	// The capture as 8-bit luminance, for QR detection. Returns a null
+	// image if the file cannot be streamed.
+	QImage loadGray(const QString& path);
+
+	// The capture binarized to 1 bit per pixel, foreground set, as
+	// Tesseract expects. Each tile of a stripe gets its own Otsu threshold
+	// and polarity unless options.binarizeThreshold fixes the threshold.
+	// Returns nullptr if the file cannot be streamed.
+	Pix* loadBinary(const QString& path, const OcrOptions& options);
+
+	// Where the bands a 1-bit page is recognized in end, each about 2048
+	// rows below the last and on a blank row where there is one within
+	// 512 rows, so Tesseract's working copies only ever cover one band.
+	// The last one is the page's height.
+	std::vector<int> bandEnds(Pix* page);
+
+}
@@ -0,0 +1,8 @@
+# Shared by the test projects: a Qt Test case on the OCR core
+QT += core gui testlib
+QT -= widgets
+CONFIG += c++17 testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../ocrcore.pri)
@@ -0,0 +1,9 @@
+# Unit tests of the core: qmake6 tests/tests.pro && make check
+TEMPLATE = subdirs
+SUBDIRS += tst_ocrapi
+SUBDIRS += tst_kernels
+SUBDIRS += tst_bufferpool
+SUBDIRS += tst_stripes
+SUBDIRS += tst_refinement
+SUBDIRS += tst_scripts
+SUBDIRS += tst_segmentation
@@ -0,0 +1,105 @@
+// qt imports
+#include <QImage>
+#include <QTest>
+#include <cstdint>
+#include "bufferpool.h"
+
+class TestBufferPool : public QObject {
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void init();
+	void nearbySizesShareAClass();
+	void otherClassesDoNot();
+	void smallAllocationsAreUntracked();
+	void buffersAreAligned();
+	void imagesGoBackToThePool();
+	void trimFreesKeptBuffers();
+};
+
+void TestBufferPool::initTestCase() {
+	// The limit is read once; keep the default whatever the environment says
+	qputenv("OCR_BUFFER_POOL_MB", "128");
+}
+
+void TestBufferPool::init() {
+	BufferPool::trim();
+}
+
+void TestBufferPool::nearbySizesShareAClass() {
+	void* first = BufferPool::allocate(100000);
+	QVERIFY(first);
+	BufferPool::release(first);
+	QVERIFY(BufferPool::stats().retainedBytes > 0);
+
+	const BufferPool::Stats before = BufferPool::stats();
+	void* second = BufferPool::allocate(101000);
+	QCOMPARE(second, first);
+	QCOMPARE(BufferPool::stats().hits, before.hits + 1);
+	QCOMPARE(BufferPool::stats().retainedBytes, int64_t(0));
+	BufferPool::release(second);
+}
+
+void TestBufferPool::otherClassesDoNot() {
+	void* first = BufferPool::allocate(100000);
+	BufferPool::release(first);
+
+	const BufferPool::Stats before = BufferPool::stats();
+	void* second = BufferPool::allocate(120000);
+	QCOMPARE(BufferPool::stats().misses, before.misses + 1);
+	QCOMPARE(BufferPool::stats().retainedBytes, before.retainedBytes);
+	BufferPool::release(second);
+}
+
+void TestBufferPool::smallAllocationsAreUntracked() {
+	const BufferPool::Stats before = BufferPool::stats();
+	void* data = BufferPool::allocate(1000);
+	QVERIFY(data);
+	BufferPool::release(data);
+	const BufferPool::Stats after = BufferPool::stats();
+	QCOMPARE(after.hits, before.hits);
+	QCOMPARE(after.misses, before.misses);
+	QCOMPARE(after.inUseBytes, before.inUseBytes);
+	QCOMPARE(after.retainedBytes, before.retainedBytes);
+	BufferPool::release(nullptr);
+}
+
+void TestBufferPool::buffersAreAligned() {
+	for (size_t size : { size_t(65536), size_t(70001), size_t(1000000), size_t(8294400) }) {
+		void* data = BufferPool::allocate(size);
+		QVERIFY(data);
+		QCOMPARE(reinterpret_cast<uintptr_t>(data) % 64, uintptr_t(0));
+		BufferPool::release(data);
+	}
+}
+
+void TestBufferPool::imagesGoBackToThePool() {
+	const int64_t inUse = BufferPool::stats().inUseBytes;
+	{
+		QImage image = BufferPool::image(QSize(640, 480), QImage::Format_RGB32);
+		QVERIFY(!image.isNull());
+		QCOMPARE(image.bytesPerLine(), qsizetype(640 * 4));
+		QVERIFY(BufferPool::stats().inUseBytes >= inUse + 640 * 480 * 4);
+		// Copies share the buffer until the last one is gone
+		const QImage copy = image;
+		image = QImage();
+		QVERIFY(!copy.isNull());
+		QVERIFY(BufferPool::stats().inUseBytes > inUse);
+	}
+	QCOMPARE(BufferPool::stats().inUseBytes, inUse);
+	QVERIFY(BufferPool::stats().retainedBytes >= 640 * 480 * 4);
+
+	QVERIFY(BufferPool::image(QSize(), QImage::Format_RGB32).isNull());
+}
+
+void TestBufferPool::trimFreesKeptBuffers() {
+	void* data = BufferPool::allocate(1 << 20);
+	BufferPool::release(data);
+	QVERIFY(BufferPool::stats().retainedBytes > 0);
+	BufferPool::trim();
+	QCOMPARE(BufferPool::stats().retainedBytes, int64_t(0));
+}
+
+QTEST_APPLESS_MAIN(TestBufferPool)
+#include "tst_bufferpool.moc"
@@ -0,0 +1,4 @@
+include(../test.pri)
+
+TARGET = tst_bufferpool
+SOURCES += ../tst_bufferpool.cpp
@@ -0,0 +1,106 @@
+// qt imports
+#include <QByteArray>
+#include <QRgb>
+#include <QTest>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "kernels.h"
+
+// Every backend is compared with the definitions the scalar loops follow.
+// ctest runs this once per backend with OCR_KERNELS set; backends the CPU
+// lacks fall back to the best one it has.
+class TestKernels : public QObject {
+	Q_OBJECT
+
+private slots:
+	void backendIsCapped();
+	void grayscaleMatchesQGray();
+	void thresholdMatchesScalar();
+	void sumMatchesScalar();
+
+private:
+	// Lengths around every register width, plus a long run
+	const std::vector<size_t> m_sizes = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 1000, 4099 };
+	// Guard bytes after the output, which no kernel may write
+	static constexpr size_t kGuard = 64;
+	static constexpr uint8_t kGuardValue = 0xAB;
+
+	std::vector<uint8_t> randomBytes(size_t size, unsigned seed) const {
+		std::mt19937 random(seed);
+		std::vector<uint8_t> bytes(size);
+		for (uint8_t& byte : bytes) {
+			byte = static_cast<uint8_t>(random());
+		}
+		return bytes;
+	}
+};
+
+void TestKernels::backendIsCapped() {
+	const Kernels::Backend cpu = Kernels::cpuBackend();
+	QVERIFY(Kernels::backend() <= cpu);
+
+	Kernels::Backend expected = cpu;
+	const QByteArray requested = qgetenv("OCR_KERNELS");
+	for (Kernels::Backend backend : { Kernels::Backend::Scalar, Kernels::Backend::Sse42, Kernels::Backend::Avx2,
+		Kernels::Backend::Avx512 }) {
+		if (requested == Kernels::backendName(backend) && backend < cpu) {
+			expected = backend;
+		}
+	}
+	QCOMPARE(QByteArray(Kernels::backendName(Kernels::backend())), QByteArray(Kernels::backendName(expected)));
+}
+
+void TestKernels::grayscaleMatchesQGray() {
+	const Kernels::Table& kernels = Kernels::table();
+	for (size_t pixels : m_sizes) {
+		// Unaligned starts too, as for images cropped at any column
+		for (size_t offset = 0; offset < 4; ++offset) {
+			const std::vector<uint8_t> bgra = randomBytes(offset * 4 + pixels * 4, static_cast<unsigned>(pixels));
+			std::vector<uint8_t> gray(offset + pixels + kGuard, kGuardValue);
+			kernels.grayscale(bgra.data() + offset * 4, gray.data() + offset, pixels);
+
+			for (size_t i = 0; i < pixels; ++i) {
+				const uint8_t* p = bgra.data() + (offset + i) * 4;
+				QCOMPARE(static_cast<int>(gray[offset + i]), qGray(p[2], p[1], p[0]));
+			}
+			for (size_t i = offset + pixels; i < gray.size(); ++i) {
+				QCOMPARE(gray[i], kGuardValue);
+			}
+		}
+	}
+}
+
+void TestKernels::thresholdMatchesScalar() {
+	const Kernels::Table& kernels = Kernels::table();
+	for (size_t size : m_sizes) {
+		for (int threshold : { 0, 1, 127, 128, 254, 255 }) {
+			const std::vector<uint8_t> source = randomBytes(size, static_cast<unsigned>(size + threshold));
+			std::vector<uint8_t> data = source;
+			data.resize(size + kGuard, kGuardValue);
+			kernels.threshold(data.data(), size, static_cast<uint8_t>(threshold));
+
+			for (size_t i = 0; i < size; ++i) {
+				QCOMPARE(static_cast<int>(data[i]), source[i] >= threshold ? 255 : 0);
+			}
+			for (size_t i = size; i < data.size(); ++i) {
+				QCOMPARE(data[i], kGuardValue);
+			}
+		}
+	}
+}
+
+void TestKernels::sumMatchesScalar() {
+	const Kernels::Table& kernels = Kernels::table();
+	for (size_t size : m_sizes) {
+		const std::vector<uint8_t> data = randomBytes(size, static_cast<unsigned>(size * 3));
+		QCOMPARE(kernels.sum(data.data(), size), std::accumulate(data.begin(), data.end(), uint64_t(0)));
+	}
+	// All 255, where 16-bit partial sums would overflow
+	const std::vector<uint8_t> white(1 << 20, 255);
+	QCOMPARE(kernels.sum(white.data(), white.size()), uint64_t(255) << 20);
+}
+
+QTEST_APPLESS_MAIN(TestKernels)
+#include "tst_kernels.moc"
@@ -0,0 +1,4 @@
+include(../test.pri)
+
+TARGET = tst_kernels
+SOURCES += ../tst_kernels.cpp
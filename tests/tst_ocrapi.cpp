@@ -0,0 +1,80 @@
+// qt imports
+#include <QTest>
+#include <cstring>
+#include <vector>
+#include "ocrapi.h"
+
+// The C interface's argument checks, which need no language data
+class TestOcrApi : public QObject {
+	Q_OBJECT
+
+private slots:
+	void version();
+	void createRejectsBadArguments();
+	void recognizeRejectsBadArguments_data();
+	void recognizeRejectsBadArguments();
+	void recognizeFileRejectsBadArguments();
+	void nullResults();
+};
+
+namespace {
+
+	bool isInvalid(ocr_result* result) {
+		const bool invalid = result && !ocr_result_success(result)
+			&& std::strcmp(ocr_result_error(result), "Invalid arguments") == 0 && ocr_result_text_length(result) == 0;
+		ocr_result_free(result);
+		return invalid;
+	}
+
+}
+
+void TestOcrApi::version() {
+	QCOMPARE(ocr_api_version(), unsigned(OCR_API_VERSION));
+}
+
+void TestOcrApi::createRejectsBadArguments() {
+	QVERIFY(!ocr_engine_create(nullptr, nullptr));
+	QVERIFY(!ocr_engine_create("eng", "/nonexistent/profile.ini"));
+	ocr_engine_destroy(nullptr);
+}
+
+void TestOcrApi::recognizeRejectsBadArguments_data() {
+	QTest::addColumn<int>("width");
+	QTest::addColumn<int>("height");
+	QTest::addColumn<int>("stride");
+
+	QTest::newRow("valid size") << 16 << 16 << 64;
+	QTest::newRow("zero width") << 0 << 16 << 64;
+	QTest::newRow("negative height") << 16 << -1 << 64;
+	QTest::newRow("short stride") << 16 << 16 << 15;
+}
+
+void TestOcrApi::recognizeRejectsBadArguments() {
+	QFETCH(int, width);
+	QFETCH(int, height);
+	QFETCH(int, stride);
+
+	// Without language data there is no engine to pass; every call fails on
+	// its arguments before one is needed
+	const std::vector<uint8_t> pixels(64 * 16);
+	QVERIFY(isInvalid(ocr_recognize_rgba(nullptr, pixels.data(), width, height, stride, 0)));
+	QVERIFY(isInvalid(ocr_recognize_gray(nullptr, pixels.data(), width, height, stride, OCR_DETECT_QR)));
+	QVERIFY(isInvalid(ocr_recognize_gray(nullptr, nullptr, 16, 16, 16, 0)));
+}
+
+void TestOcrApi::recognizeFileRejectsBadArguments() {
+	QVERIFY(isInvalid(ocr_recognize_file(nullptr, "capture.png", 0)));
+	QVERIFY(isInvalid(ocr_recognize_file(nullptr, nullptr, OCR_DETECT_QR)));
+}
+
+void TestOcrApi::nullResults() {
+	QVERIFY(!ocr_result_success(nullptr));
+	QVERIFY(!ocr_result_is_qr_code(nullptr));
+	QCOMPARE(ocr_result_text(nullptr), "");
+	QCOMPARE(ocr_result_text_length(nullptr), size_t(0));
+	QCOMPARE(ocr_result_error(nullptr), "");
+	ocr_result_free(nullptr);
+}
+
+QTEST_APPLESS_MAIN(TestOcrApi)
+#include "tst_ocrapi.moc"
@@ -0,0 +1,7 @@
+include(../test.pri)
+
+# qmake links the core statically, so this covers the same code as the
+# shared library without its export map
+TARGET = tst_ocrapi
+SOURCES += ../tst_ocrapi.cpp ../../ocrapi.cpp
+HEADERS += ../../ocrapi.h
@@ -0,0 +1,100 @@
+// qt imports
+#include <QSize>
+#include <QTest>
+#include <QtMath>
+#include "refinement.h"
+
+class TestRefinement : public QObject {
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void fullOnlyWithoutQuickFirst();
+	void smallCaptureWithoutCascade();
+	void smallCaptureWithCascade();
+	void downscaledFastPass();
+	void stripeCaptureKeepsScale();
+	void pointerPass();
+};
+
+void TestRefinement::initTestCase() {
+	// The stripe threshold is read once; keep the default whatever the
+	// environment says
+	qputenv("OCR_STRIPE_MIN_MEGAPIXELS", "24");
+}
+
+void TestRefinement::fullOnlyWithoutQuickFirst() {
+	OcrOptions profile;
+	profile.cascadeConfidence = 60;
+	const std::vector<Refinement::Pass> passes = Refinement::passesFor(QSize(4000, 3000), profile, true, false);
+	QCOMPARE(passes.size(), size_t(1));
+	QCOMPARE(passes[0].name, QString("full"));
+	QVERIFY(passes[0].qr);
+	QVERIFY(passes[0].ocr);
+	QVERIFY(!passes[0].quick);
+	QCOMPARE(passes[0].options.cascadeConfidence, 60);
+}
+
+void TestRefinement::smallCaptureWithoutCascade() {
+	// A fast pass would only recognize the same image twice
+	const std::vector<Refinement::Pass> passes = Refinement::passesFor(QSize(800, 600), OcrOptions(), true, true);
+	QCOMPARE(passes.size(), size_t(1));
+	QCOMPARE(passes[0].name, QString("full"));
+	QVERIFY(passes[0].qr);
+}
+
+void TestRefinement::smallCaptureWithCascade() {
+	OcrOptions profile;
+	profile.cascadeConfidence = 60;
+	const std::vector<Refinement::Pass> passes = Refinement::passesFor(QSize(800, 600), profile, true, true);
+	QCOMPARE(passes.size(), size_t(2));
+	QCOMPARE(passes[0].name, QString("fast"));
+	QVERIFY(!passes[0].qr);
+	QVERIFY(passes[0].quick);
+	QVERIFY(passes[0].options.grayscale);
+	QCOMPARE(passes[0].options.cascadeConfidence, 0);
+	QCOMPARE(passes[0].options.scale, 1.0);
+	QCOMPARE(passes[1].name, QString("full"));
+	QVERIFY(passes[1].qr);
+	QVERIFY(!passes[1].quick);
+	QCOMPARE(passes[1].options.cascadeConfidence, 60);
+}
+
+void TestRefinement::downscaledFastPass() {
+	OcrOptions profile;
+	profile.scale = 2.0;
+	// Down to about 2 megapixels
+	std::vector<Refinement::Pass> passes = Refinement::passesFor(QSize(2000, 1500), profile, false, true);
+	QCOMPARE(passes.size(), size_t(2));
+	QCOMPARE(passes[0].name, QString("fast"));
+	QVERIFY(qAbs(passes[0].options.scale - 2.0 * qSqrt(2e6 / 3e6)) < 1e-9);
+	QCOMPARE(passes[1].options.scale, 2.0);
+	QVERIFY(!passes[1].qr);
+
+	// But never below half
+	passes = Refinement::passesFor(QSize(4000, 3000), profile, false, true);
+	QCOMPARE(passes.size(), size_t(2));
+	QCOMPARE(passes[0].options.scale, 1.0);
+}
+
+void TestRefinement::stripeCaptureKeepsScale() {
+	// Stripe captures are recognized at scale 1 anyway
+	const std::vector<Refinement::Pass> passes = Refinement::passesFor(QSize(6000, 5000), OcrOptions(), false, true);
+	QCOMPARE(passes.size(), size_t(1));
+	QCOMPARE(passes[0].name, QString("full"));
+}
+
+void TestRefinement::pointerPass() {
+	OcrOptions profile;
+	profile.invertDark = true;
+	const Refinement::Pass pass = Refinement::pointerPass(QPoint(120, 40), profile);
+	QVERIFY(pass.nearPoint);
+	// Script detection waits until the line is shown
+	QVERIFY(pass.quick);
+	QCOMPARE(pass.point, QPoint(120, 40));
+	QVERIFY(!pass.qr);
+	QVERIFY(pass.options.invertDark);
+}
+
+QTEST_APPLESS_MAIN(TestRefinement)
+#include "tst_refinement.moc"
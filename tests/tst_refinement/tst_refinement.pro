@@ -0,0 +1,5 @@
+include(../test.pri)
+
+TARGET = tst_refinement
+SOURCES += ../tst_refinement.cpp ../../refinement.cpp
+HEADERS += ../../refinement.h
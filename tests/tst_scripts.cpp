@@ -0,0 +1,48 @@
+// qt imports
+#include <QStringList>
+#include <QTest>
+#include "scripts.h"
+
+class TestScripts : public QObject {
+	Q_OBJECT
+
+private slots:
+	void scriptsOf();
+	void select_data();
+	void select();
+};
+
+void TestScripts::scriptsOf() {
+	QCOMPARE(Scripts::scriptsOf("deu"), QStringList({ "Latin" }));
+	QVERIFY(Scripts::scriptsOf("jpn").contains("Han"));
+	QCOMPARE(Scripts::scriptsOf("jpn_vert"), Scripts::scriptsOf("jpn"));
+	QCOMPARE(Scripts::scriptsOf("chi_tra_vert"), Scripts::scriptsOf("chi_tra"));
+	QVERIFY(Scripts::scriptsOf("equ").isEmpty());
+}
+
+void TestScripts::select_data() {
+	QTest::addColumn<QString>("languages");
+	QTest::addColumn<QStringList>("scripts");
+	QTest::addColumn<QString>("expected");
+
+	QTest::newRow("latin") << "eng+jpn" << QStringList({ "Latin" }) << "eng";
+	QTest::newRow("japanese") << "eng+jpn" << QStringList({ "Japanese" }) << "jpn";
+	QTest::newRow("both") << "eng+jpn" << QStringList({ "Japanese", "Latin" }) << "eng+jpn";
+	// The first language stays the primary one
+	QTest::newRow("han keeps order") << "jpn+eng+chi_sim" << QStringList({ "Han" }) << "jpn+chi_sim";
+	QTest::newRow("unknown kept") << "eng+equ+rus" << QStringList({ "Cyrillic" }) << "equ+rus";
+	QTest::newRow("no match") << "eng+jpn" << QStringList({ "Arabic" }) << "eng+jpn";
+	QTest::newRow("nothing detected") << "eng+jpn" << QStringList() << "eng+jpn";
+	QTest::newRow("vertical model") << "eng+jpn_vert" << QStringList({ "Hiragana" }) << "jpn_vert";
+	QTest::newRow("single") << "eng" << QStringList({ "Latin" }) << "eng";
+}
+
+void TestScripts::select() {
+	QFETCH(QString, languages);
+	QFETCH(QStringList, scripts);
+	QFETCH(QString, expected);
+	QCOMPARE(Scripts::select(languages, scripts), expected);
+}
+
+QTEST_APPLESS_MAIN(TestScripts)
+#include "tst_scripts.moc"
@@ -0,0 +1,4 @@
+include(../test.pri)
+
+TARGET = tst_scripts
+SOURCES += ../tst_scripts.cpp
@@ -0,0 +1,241 @@
+#include <leptonica/allheaders.h>
+#include <tesseract/publictypes.h>
+// qt imports
+#include <QTest>
+#include <memory>
+#include "segmentation.h"
+
+namespace {
+
+	struct PixDeleter {
+		void operator()(Pix* pix) const { pixDestroy(&pix); }
+	};
+	using Page = std::unique_ptr<Pix, PixDeleter>;
+
+	// A blank 1-bit page, as Tesseract thresholds a capture
+	Page blankPage(int width, int height) {
+		return Page(pixCreate(width, height, 1));
+	}
+
+	void fill(Pix* page, int x, int y, int width, int height) {
+		for (int row = y; row < y + height; ++row) {
+			for (int column = x; column < x + width; ++column) {
+				pixSetPixel(page, column, row, 1);
+			}
+		}
+	}
+
+	// Latin-like letters 6 pixels wide and a pixel apart: an x-height box
+	// from y + 3 to y + 9, with ascenders and descenders on some of them.
+	// Returns where the word ends.
+	int word(Pix* page, int x, int y, int letters) {
+		for (int i = 0; i < letters; ++i) {
+			fill(page, x, y + 3, 6, 1);
+			fill(page, x, y + 8, 6, 1);
+			fill(page, x, y + 3, 1, 6);
+			if (i % 3 == 0) {
+				fill(page, x + 5, y, 1, 9);
+			}
+			if (i % 4 == 1) {
+				fill(page, x + 5, y + 3, 1, 9);
+			}
+			else {
+				fill(page, x + 5, y + 3, 1, 6);
+			}
+			x += 7;
+		}
+		return x;
+	}
+
+	int line(Pix* page, int x, int y, int words, int letters) {
+		for (int i = 0; i < words; ++i) {
+			x = word(page, x, y, letters) + 4;
+		}
+		return x;
+	}
+
+	// A Han-like character in a 12 pixel square: three bars, a stem and
+	// two side strokes
+	void han(Pix* page, int x, int y) {
+		fill(page, x, y + 1, 12, 1);
+		fill(page, x + 1, y + 6, 10, 1);
+		fill(page, x, y + 11, 12, 1);
+		fill(page, x + 5, y, 1, 12);
+		fill(page, x + 2, y + 2, 1, 8);
+		fill(page, x + 10, y + 3, 1, 7);
+	}
+
+	bool isVertical(Pix* page) {
+		return Segmentation::isVertical(page, 0, 0, pixGetWidth(page), pixGetHeight(page));
+	}
+
+}
+
+class TestSegmentation : public QObject {
+	Q_OBJECT
+
+private slots:
+	void blankPageIsPage();
+	void word();
+	void line();
+	void block();
+	void touchingLinesAreBlock();
+	void sparse();
+	void columnsArePage();
+	void verticalGrid();
+	void verticalColumn();
+	void horizontalTextIsNotVertical();
+	void verticalRectangle();
+	void verticalModels();
+	void pageSegModes();
+};
+
+void TestSegmentation::blankPageIsPage() {
+	const Page page = blankPage(200, 100);
+	QCOMPARE(Segmentation::classify(page.get()), Segmentation::Layout::Page);
+	QVERIFY(!isVertical(page.get()));
+	QCOMPARE(Segmentation::classify(nullptr), Segmentation::Layout::Page);
+	QVERIFY(!Segmentation::isVertical(nullptr, 0, 0, 10, 10));
+}
+
+void TestSegmentation::word() {
+	const Page page = blankPage(100, 30);
+	::word(page.get(), 10, 9, 5);
+	QCOMPARE(Segmentation::classify(page.get()), Segmentation::Layout::Word);
+}
+
+void TestSegmentation::line() {
+	const Page page = blankPage(400, 30);
+	::line(page.get(), 10, 9, 6, 5);
+	QCOMPARE(Segmentation::classify(page.get()), Segmentation::Layout::Line);
+}
+
+void TestSegmentation::block() {
+	const Page page = blankPage(400, 200);
+	for (int i = 0; i < 8; ++i) {
+		::line(page.get(), 10, 10 + i * 18, 6, 5);
+	}
+	QCOMPARE(Segmentation::classify(page.get()), Segmentation::Layout::Block);
+}
+
+void TestSegmentation::touchingLinesAreBlock() {
+	// The descenders of the first line reach the ascenders of the second,
+	// so no row between them is blank
+	const Page page = blankPage(400, 60);
+	::line(page.get(), 10, 9, 6, 5);
+	::line(page.get(), 10, 21, 6, 5);
+	QCOMPARE(Segmentation::classify(page.get()), Segmentation::Layout::Block);
+}
+
+void TestSegmentation::sparse() {
+	const Page page = blankPage(800, 600);
+	::line(page.get(), 10, 10, 2, 5);
+	::line(page.get(), 500, 300, 1, 4);
+	::line(page.get(), 100, 550, 2, 3);
+	QCOMPARE(Segmentation::classify(page.get()), Segmentation::Layout::Sparse);
+}
+
+void TestSegmentation::columnsArePage() {
+	const Page page = blankPage(800, 300);
+	for (int i = 0; i < 8; ++i) {
+		::line(page.get(), 10, 10 + i * 18, 6, 5);
+		::line(page.get(), 450, 10 + i * 18, 6, 5);
+	}
+	QCOMPARE(Segmentation::classify(page.get()), Segmentation::Layout::Page);
+}
+
+void TestSegmentation::verticalGrid() {
+	// Four columns read right to left, characters 2 pixels apart down a
+	// column and 8 across
+	const Page page = blankPage(200, 300);
+	for (int column = 0; column < 4; ++column) {
+		for (int i = 0; i < 10; ++i) {
+			han(page.get(), 150 - column * 20, 10 + i * 14);
+		}
+	}
+	QVERIFY(isVertical(page.get()));
+}
+
+void TestSegmentation::verticalColumn() {
+	const Page page = blankPage(60, 300);
+	for (int i = 0; i < 12; ++i) {
+		han(page.get(), 20, 10 + i * 14);
+	}
+	QVERIFY(isVertical(page.get()));
+}
+
+void TestSegmentation::horizontalTextIsNotVertical() {
+	const Page grid = blankPage(300, 200);
+	for (int row = 0; row < 4; ++row) {
+		for (int i = 0; i < 10; ++i) {
+			han(grid.get(), 10 + i * 14, 10 + row * 20);
+		}
+	}
+	QVERIFY(!isVertical(grid.get()));
+
+	const Page single = blankPage(300, 40);
+	for (int i = 0; i < 12; ++i) {
+		han(single.get(), 10 + i * 14, 10);
+	}
+	QVERIFY(!isVertical(single.get()));
+
+	const Page latin = blankPage(400, 200);
+	for (int i = 0; i < 8; ++i) {
+		::line(latin.get(), 10, 10 + i * 18, 6, 5);
+	}
+	QVERIFY(!isVertical(latin.get()));
+
+	// A table's columns are much wider than a character
+	const Page table = blankPage(400, 200);
+	for (int row = 0; row < 8; ++row) {
+		for (int i = 0; i < 8; ++i) {
+			han(table.get(), 10 + i * 14, 10 + row * 20);
+			han(table.get(), 250 + i * 14, 10 + row * 20);
+		}
+	}
+	QVERIFY(!isVertical(table.get()));
+}
+
+void TestSegmentation::verticalRectangle() {
+	// Horizontal lines on the left, a vertical column on the right; only
+	// the rectangle asked about counts, and it is clipped to the page
+	const Page page = blankPage(400, 300);
+	for (int i = 0; i < 8; ++i) {
+		::line(page.get(), 10, 10 + i * 18, 4, 5);
+	}
+	for (int i = 0; i < 12; ++i) {
+		han(page.get(), 340, 10 + i * 14);
+	}
+	QVERIFY(!Segmentation::isVertical(page.get(), 0, 0, 300, 300));
+	QVERIFY(Segmentation::isVertical(page.get(), 320, 0, 60, 300));
+	QVERIFY(Segmentation::isVertical(page.get(), 320, -50, 500, 500));
+	QVERIFY(!Segmentation::isVertical(page.get(), 500, 0, 60, 300));
+}
+
+void TestSegmentation::verticalModels() {
+	const Page vertical = blankPage(200, 300);
+	for (int column = 0; column < 4; ++column) {
+		for (int i = 0; i < 10; ++i) {
+			han(vertical.get(), 150 - column * 20, 10 + i * 14);
+		}
+	}
+	// Horizontal models leave vertical text to Tesseract's own analysis
+	QCOMPARE(Segmentation::classify(vertical.get()), Segmentation::Layout::Page);
+	QCOMPARE(Segmentation::classify(vertical.get(), true), Segmentation::Layout::Vertical);
+
+	const Page horizontal = blankPage(400, 30);
+	::line(horizontal.get(), 10, 9, 6, 5);
+	QCOMPARE(Segmentation::classify(horizontal.get(), true), Segmentation::Layout::Page);
+}
+
+void TestSegmentation::pageSegModes() {
+	QCOMPARE(Segmentation::pageSegMode(Segmentation::Layout::Word), int(tesseract::PSM_SINGLE_WORD));
+	QCOMPARE(Segmentation::pageSegMode(Segmentation::Layout::Line), int(tesseract::PSM_SINGLE_LINE));
+	QCOMPARE(Segmentation::pageSegMode(Segmentation::Layout::Block), int(tesseract::PSM_SINGLE_BLOCK));
+	QCOMPARE(Segmentation::pageSegMode(Segmentation::Layout::Sparse), int(tesseract::PSM_SPARSE_TEXT));
+	QCOMPARE(Segmentation::pageSegMode(Segmentation::Layout::Page), int(tesseract::PSM_AUTO));
+	QCOMPARE(Segmentation::pageSegMode(Segmentation::Layout::Vertical), int(tesseract::PSM_SINGLE_BLOCK_VERT_TEXT));
+}
+
+QTEST_APPLESS_MAIN(TestSegmentation)
+#include "tst_segmentation.moc"
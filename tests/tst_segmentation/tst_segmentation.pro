@@ -0,0 +1,4 @@
+include(../test.pri)
+
+TARGET = tst_segmentation
+SOURCES += ../tst_segmentation.cpp
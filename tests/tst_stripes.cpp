@@ -0,0 +1,132 @@
+#include <leptonica/allheaders.h>
+// qt imports
+#include <QImage>
+#include <QTemporaryDir>
+#include <QTest>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "ocr.h"
+#include "stripes.h"
+
+namespace {
+
+	struct PixDeleter {
+		void operator()(Pix* pix) const { pixDestroy(&pix); }
+	};
+	using Page = std::unique_ptr<Pix, PixDeleter>;
+
+	void fillRows(Pix* page, int top, int bottom) {
+		for (int y = top; y < bottom; ++y) {
+			pixSetPixel(page, 10, y, 1);
+		}
+	}
+
+}
+
+class TestStripes : public QObject {
+	Q_OBJECT
+
+private slots:
+	void blankPageBands();
+	void bandEndsOnBlankRow();
+	void bandEndsBelowTallInk();
+	void grayMatchesQGray();
+	void tilesHaveTheirOwnPolarity();
+
+private:
+	QTemporaryDir m_dir;
+};
+
+void TestStripes::blankPageBands() {
+	const Page page(pixCreate(100, 5000, 1));
+	QCOMPARE(Stripes::bandEnds(page.get()), std::vector<int>({ 2048, 4096, 5000 }));
+
+	const Page single(pixCreate(100, 300, 1));
+	QCOMPARE(Stripes::bandEnds(single.get()), std::vector<int>({ 300 }));
+}
+
+void TestStripes::bandEndsOnBlankRow() {
+	// A paragraph across the band boundary; the band ends above it
+	const Page page(pixCreate(100, 5000, 1));
+	fillRows(page.get(), 1900, 2100);
+	QCOMPARE(Stripes::bandEnds(page.get()), std::vector<int>({ 1899, 3947, 5000 }));
+}
+
+void TestStripes::bandEndsBelowTallInk() {
+	// No blank row within reach above the target: the first one below it,
+	// and no further than the slack allows
+	const Page below(pixCreate(100, 5000, 1));
+	fillRows(below.get(), 1500, 2300);
+	QCOMPARE(Stripes::bandEnds(below.get()).front(), 2300);
+
+	const Page solid(pixCreate(100, 5000, 1));
+	fillRows(solid.get(), 1500, 2700);
+	QCOMPARE(Stripes::bandEnds(solid.get()).front(), 2560);
+}
+
+void TestStripes::grayMatchesQGray() {
+	QVERIFY(m_dir.isValid());
+	// More rows than a stripe and an odd width
+	QImage image(301, 700, QImage::Format_RGB32);
+	std::mt19937 random(59);
+	for (int y = 0; y < image.height(); ++y) {
+		QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+		for (int x = 0; x < image.width(); ++x) {
+			line[x] = qRgb(random() & 0xFF, random() & 0xFF, random() & 0xFF);
+		}
+	}
+	const QString path = m_dir.filePath("gray.png");
+	QVERIFY(image.save(path, "PNG"));
+
+	const QImage gray = Stripes::loadGray(path);
+	QCOMPARE(gray.format(), QImage::Format_Grayscale8);
+	QCOMPARE(gray.size(), image.size());
+	for (int y = 0; y < image.height(); ++y) {
+		const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+		const uchar* grayLine = gray.constScanLine(y);
+		for (int x = 0; x < image.width(); ++x) {
+			// libpng rounds where qGray() truncates
+			if (std::abs(grayLine[x] - qGray(line[x])) > 1) {
+				QFAIL(qPrintable(QString("Pixel %1,%2 is %3, qGray() %4").arg(x).arg(y).arg(grayLine[x])
+					.arg(qGray(line[x]))));
+			}
+		}
+	}
+
+	QVERIFY(Stripes::loadGray(m_dir.filePath("missing.png")).isNull());
+}
+
+void TestStripes::tilesHaveTheirOwnPolarity() {
+	QVERIFY(m_dir.isValid());
+	// A dark tile with light text next to a light tile with dark text
+	QImage image(1024, 300, QImage::Format_Grayscale8);
+	for (int y = 0; y < image.height(); ++y) {
+		uchar* line = image.scanLine(y);
+		for (int x = 0; x < image.width(); ++x) {
+			const bool text = y >= 100 && y < 120 && (x % 512) >= 100 && (x % 512) < 300;
+			if (x < 512) {
+				line[x] = text ? 230 : 20;
+			}
+			else {
+				line[x] = text ? 15 : 235;
+			}
+		}
+	}
+	const QString path = m_dir.filePath("polarity.png");
+	QVERIFY(image.save(path, "PNG"));
+
+	const Page page(Stripes::loadBinary(path, OcrOptions()));
+	QVERIFY(page);
+	for (int x : { 150, 662 }) {
+		l_uint32 value = 0;
+		pixGetPixel(page.get(), x, 110, &value);
+		QCOMPARE(value, l_uint32(1));
+		pixGetPixel(page.get(), x, 50, &value);
+		QCOMPARE(value, l_uint32(0));
+	}
+}
+
+QTEST_APPLESS_MAIN(TestStripes)
+#include "tst_stripes.moc"
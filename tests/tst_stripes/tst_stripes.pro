@@ -0,0 +1,4 @@
+include(../test.pri)
+
+TARGET = tst_stripes
+SOURCES += ../tst_stripes.cpp
@@ -0,0 +1,213 @@
+#include "trace.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Trace {
+
+	std::atomic<bool> g_enabled{ false };
+	std::atomic<const SpanHooks*> g_hooks{ nullptr };
+
+	namespace {
+
+		struct Event {
+			const char* name;
+			const char* category;
+			int64_t start;
+			int64_t duration;
+			std::string detail;
+		};
+
+		// Each thread appends to its own buffer; the per-buffer mutex is only
+		// ever contended while the trace is being written out.
+		struct ThreadBuffer {
+			std::mutex mutex;
+			long tid = 0;
+			std::string name;
+			std::vector<Event> events;
+		};
+
+		struct Registry {
+			std::mutex mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		};
+
+		Registry& registry() {
+			static Registry instance;
+			return instance;
+		}
+
+		const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+		ThreadBuffer& threadBuffer() {
+			// Buffers are owned by the registry so events outlive their thread
+			thread_local ThreadBuffer* buffer = [] {
+				auto owned = std::make_unique<ThreadBuffer>();
+				owned->tid = static_cast<long>(::syscall(SYS_gettid));
+				owned->events.reserve(256);
+				ThreadBuffer* raw = owned.get();
+				Registry& reg = registry();
+				std::lock_guard<std::mutex> lock(reg.mutex);
+				reg.buffers.push_back(std::move(owned));
+				return raw;
+			}();
+			return *buffer;
+		}
+
+		void append(const char* name, const char* category, int64_t start, int64_t end, std::string detail) {
+			ThreadBuffer& buffer = threadBuffer();
+			std::lock_guard<std::mutex> lock(buffer.mutex);
+			buffer.events.push_back({ name, category, start, end - start, std::move(detail) });
+		}
+
+	}
+
+	int64_t now() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - s_epoch).count();
+	}
+
+	void enable() {
+		g_enabled.store(true, std::memory_order_relaxed);
+		setThreadName("main");
+	}
+
+	void addSpanHooks(SpanHooks* hooks) {
+		const SpanHooks* head = g_hooks.load(std::memory_order_acquire);
+		do {
+			for (const SpanHooks* it = head; it; it = it->next) {
+				if (it == hooks) {
+					return;
+				}
+			}
+			hooks->next = head;
+		} while (!g_hooks.compare_exchange_weak(head, hooks, std::memory_order_release, std::memory_order_acquire));
+	}
+
+	void setThreadName(const char* name) {
+		if (!isEnabled()) {
+			return;
+		}
+		ThreadBuffer& buffer = threadBuffer();
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.name = name;
+	}
+
+	void record(const char* name, const char* category, int64_t startUs, int64_t endUs) {
+		if (isEnabled()) {
+			append(name, category, startUs, endUs, std::string());
+		}
+	}
+
+	void Span::begin() {
+		m_hooks = g_hooks.load(std::memory_order_acquire);
+		for (const SpanHooks* hooks = m_hooks; hooks; hooks = hooks->next) {
+			hooks->begin(m_name);
+		}
+		if (isEnabled()) {
+			m_start = now();
+		}
+	}
+
+	void Span::end() {
+		if (m_start >= 0) {
+			append(m_name, m_category, m_start, now(), std::move(m_detail));
+			m_start = -1;
+		}
+		// The hooks that saw the start also see the end, even if more were
+		// added in between
+		for (const SpanHooks* hooks = m_hooks; hooks; hooks = hooks->next) {
+			hooks->end(m_name);
+		}
+		m_hooks = nullptr;
+	}
+
+	void Span::setDetail(const QString& detail) {
+		if (m_start >= 0) {
+			m_detail = detail.toStdString();
+		}
+	}
+
+	bool writeChromeJson(const QString& path) {
+		const qint64 pid = ::getpid();
+		QJsonArray events;
+
+		Registry& reg = registry();
+		std::lock_guard<std::mutex> registryLock(reg.mutex);
+		for (const auto& buffer : reg.buffers) {
+			std::lock_guard<std::mutex> lock(buffer->mutex);
+
+			if (!buffer->name.empty()) {
+				QJsonObject meta;
+				meta["name"] = "thread_name";
+				meta["ph"] = "M";
+				meta["pid"] = pid;
+				meta["tid"] = static_cast<qint64>(buffer->tid);
+				meta["args"] = QJsonObject{ { "name", QString::fromStdString(buffer->name) } };
+				events.append(meta);
+			}
+
+			for (const Event& event : buffer->events) {
+				QJsonObject object;
+				object["name"] = event.name;
+				object["cat"] = event.category;
+				object["ph"] = "X";
+				object["ts"] = static_cast<qint64>(event.start);
+				object["dur"] = static_cast<qint64>(event.duration);
+				object["pid"] = pid;
+				object["tid"] = static_cast<qint64>(buffer->tid);
+				if (!event.detail.empty()) {
+					object["args"] = QJsonObject{ { "detail", QString::fromStdString(event.detail) } };
+				}
+				events.append(object);
+			}
+		}
+
+		QJsonObject root;
+		root["traceEvents"] = events;
+		root["displayTimeUnit"] = "ms";
+
+		QFile file(path);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			return false;
+		}
+		file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+		return true;
+	}
+
+	std::vector<SpanRecord> takeSpans() {
+		std::vector<SpanRecord> spans;
+
+		Registry& reg = registry();
+		std::lock_guard<std::mutex> registryLock(reg.mutex);
+		for (const auto& buffer : reg.buffers) {
+			std::lock_guard<std::mutex> lock(buffer->mutex);
+			for (const Event& event : buffer->events) {
+				spans.push_back({ event.name, event.start, event.duration, buffer->tid });
+			}
+			buffer->events.clear();
+		}
+		return spans;
+	}
+
+	Session::Session(const QString& path) : m_path(path) {
+		if (!m_path.isEmpty()) {
+			enable();
+		}
+	}
+
+	Session::~Session() {
+		if (!m_path.isEmpty() && !writeChromeJson(m_path)) {
+			qWarning("Failed to write trace to %s", qPrintable(m_path));
+		}
+	}
+
+}
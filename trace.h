@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lightweight scoped tracing that can be exported as Chrome/Perfetto
+// trace-event JSON. When tracing is disabled a span costs two relaxed
+// atomic loads.
+namespace Trace {
+
+	// Optional callbacks run at the start and end of every span, even when
+	// tracing itself is off; used by the per-stage memory accounting and the
+	// flight recorder. Registered hooks form a list that only ever grows.
+	struct SpanHooks {
+		void (*begin)(const char* name);
+		void (*end)(const char* name);
+		const SpanHooks* next = nullptr;
+	};
+
+	extern std::atomic<bool> g_enabled;
+	extern std::atomic<const SpanHooks*> g_hooks;
+
+	inline bool isEnabled() {
+		return g_enabled.load(std::memory_order_relaxed);
+	}
+
+	// Microseconds on a monotonic clock, shared by every thread
+	int64_t now();
+
+	void enable();
+
+	// Adds hooks to the front of the list; adding the same hooks twice is a no-op
+	void addSpanHooks(SpanHooks* hooks);
+
+	// Names the calling thread in the exported trace
+	void setThreadName(const char* name);
+
+	// Records a span whose start was captured before tracing was enabled
+	void record(const char* name, const char* category, int64_t startUs, int64_t endUs);
+
+	bool writeChromeJson(const QString& path);
+
+	struct SpanRecord {
+		const char* name;
+		int64_t start;
+		int64_t duration;
+		long tid;
+	};
+
+	// Removes and returns everything recorded so far, for in-process
+	// consumers such as the benchmark
+	std::vector<SpanRecord> takeSpans();
+
+	class Span {
+	public:
+		explicit Span(const char* name, const char* category = "pipeline")
+			: m_name(name), m_category(category) {
+			if (isEnabled() || g_hooks.load(std::memory_order_relaxed)) {
+				begin();
+			}
+		}
+		~Span() { end(); }
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+		// Closes the span before the end of its scope
+		void end();
+
+		// Free-form annotation shown in the trace viewer's "args" panel
+		void setDetail(const QString& detail);
+
+	private:
+		void begin();
+
+		const char* m_name;
+		const char* m_category;
+		int64_t m_start = -1;
+		const SpanHooks* m_hooks = nullptr;
+		std::string m_detail;
+	};
+
+	// Enables tracing for its lifetime and writes the JSON file when it goes
+	// out of scope, so every exit path out of main() produces a trace.
+	class Session {
+	public:
+		explicit Session(const QString& path);
+		~Session();
+
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+
+	private:
+		QString m_path;
+	};
+
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Trace::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
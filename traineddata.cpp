@@ -0,0 +1,127 @@
+#include "traineddata.h"
+
+// qt imports
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace.h"
+
+namespace Traineddata {
+
+	namespace {
+
+		bool hasTraineddata(const QString& path) {
+			return !QDir(path).entryList({ "*.traineddata" }, QDir::Files).isEmpty();
+		}
+
+		QString findDirectory() {
+			// Since Tesseract 4 TESSDATA_PREFIX names the tessdata directory
+			// itself; older setups point at its parent
+			const QString prefix = qEnvironmentVariable("TESSDATA_PREFIX");
+			if (!prefix.isEmpty()) {
+				for (const QString& candidate : { prefix, prefix + "/tessdata" }) {
+					if (hasTraineddata(candidate)) {
+						return QDir::cleanPath(candidate);
+					}
+				}
+			}
+
+			QStringList candidates;
+#ifdef OCR_TESSDATA_DIR
+			candidates << OCR_TESSDATA_DIR;
+#endif
+			candidates << "/usr/share/tessdata" << "/usr/share/tesseract-ocr/5/tessdata"
+				<< "/usr/share/tesseract-ocr/4.00/tessdata" << "/usr/local/share/tessdata";
+			for (const QString& candidate : candidates) {
+				if (hasTraineddata(candidate)) {
+					return candidate;
+				}
+			}
+			return QString();
+		}
+
+		QString findBestDirectory() {
+			const QString configured = qEnvironmentVariable("OCR_TESSDATA_BEST_DIR");
+			if (!configured.isEmpty()) {
+				return hasTraineddata(configured) ? QDir::cleanPath(configured) : QString();
+			}
+			// Distributions package tessdata_fast or tessdata; tessdata_best
+			// is usually a manual download next to it
+			const QStringList candidates = { "/usr/share/tessdata_best", "/usr/local/share/tessdata_best",
+				QDir::homePath() + "/.local/share/tessdata_best" };
+			for (const QString& candidate : candidates) {
+				if (hasTraineddata(candidate)) {
+					return candidate;
+				}
+			}
+			return QString();
+		}
+
+	}
+
+	Mapping::Mapping(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+	Mapping::~Mapping() {
+		::munmap(const_cast<char*>(m_data), m_size);
+	}
+
+	bool isEnabled() {
+		static const bool enabled = qEnvironmentVariable("OCR_MMAP_TRAINEDDATA") != "0";
+		return enabled;
+	}
+
+	QString directory() {
+		static const QString dir = findDirectory();
+		return dir;
+	}
+
+	QString bestDirectory() {
+		static const QString dir = findBestDirectory();
+		return dir;
+	}
+
+	bool hasLanguage(const QString& dataDirectory, const QString& language) {
+		if (dataDirectory.isEmpty() || language.isEmpty()) {
+			return false;
+		}
+		for (const QString& part : language.split('+')) {
+			if (!QFile::exists(dataDirectory + "/" + part + ".traineddata")) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::unique_ptr<Mapping> map(const QString& language, const QString& dataDirectory) {
+		if (!isEnabled() || language.isEmpty() || language.contains('+') || dataDirectory.isEmpty()) {
+			return nullptr;
+		}
+
+		TRACE_SCOPE("ocr.map_traineddata");
+		const QByteArray path = QFile::encodeName(dataDirectory + "/" + language + ".traineddata");
+		const int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return nullptr;
+		}
+
+		struct stat info;
+		void* data = MAP_FAILED;
+		if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+			data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		}
+		::close(fd);
+		if (data == MAP_FAILED) {
+			return nullptr;
+		}
+
+		// Init() walks the file once, front to back
+		::madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+		return std::make_unique<Mapping>(static_cast<const char*>(data), static_cast<size_t>(info.st_size));
+	}
+
+}
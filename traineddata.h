@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <cstddef>
+#include <memory>
+
+// Read-only mappings of installed .traineddata files. Initializing Tesseract
+// from a mapping saves the heap buffer it would read the whole file into
+// first; Tesseract still copies every component into its own heap, so an
+// initialized engine shares nothing with the mapping. OCR_MMAP_TRAINEDDATA=0
+// turns this off, for comparing the two.
+namespace Traineddata {
+
+	class Mapping {
+	public:
+		Mapping(const char* data, size_t size);
+		~Mapping();
+
+		Mapping(const Mapping&) = delete;
+		Mapping& operator=(const Mapping&) = delete;
+
+		const char* data() const { return m_data; }
+		size_t size() const { return m_size; }
+
+	private:
+		const char* m_data;
+		size_t m_size;
+	};
+
+	bool isEnabled();
+
+	// The directory Tesseract loads traineddata from, or empty if none of
+	// the usual locations has any
+	QString directory();
+
+	// tessdata_best models for the model cascade (OcrOptions::
+	// cascadeConfidence): OCR_TESSDATA_BEST_DIR or the usual locations, or
+	// empty if none has any
+	QString bestDirectory();
+
+	// Whether every language of e.g. "eng+jpn" is in the directory
+	bool hasLanguage(const QString& dataDirectory, const QString& language);
+
+	// Maps <dataDirectory>/<language>.traineddata, or returns nullptr if
+	// mapping is disabled or the file is missing. One language only;
+	// "eng+jpn" loads the extra languages from files either way.
+	std::unique_ptr<Mapping> map(const QString& language, const QString& dataDirectory = directory());
+
+}